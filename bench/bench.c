@@ -0,0 +1,249 @@
+/**
+ ******************************************************************************
+ * @file    bench.c
+ * @brief   Scheduler benchmarks runner.
+ *
+ *  Runs the requested benchmark suites and prints a fixed table per suite.
+ *  Each benchmark is repeated and the median run is reported, latency
+ *  percentiles are taken over the samples of all runs.
+ *
+ *  Usage: bench [micro|stress] [option=value ...]
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+#include "bench.h"
+
+/* Benchmark runner settings */
+BENCH_ConfigTypeDef gBenchCfg = {
+    .runs       = BENCH_RUNS,
+    .yielders   = 50,
+    .delayers   = 25,
+    .waiters    = 25,
+    .delay      = 10,
+    .stack_size = BENCH_STACK_SIZE,
+    .window     = 2000,
+    .max_tasks  = 1000000,
+    .stackless  = 0,
+    .shared     = 0,
+};
+
+/* Command line options */
+static const struct
+{
+    const char *name;
+    uint32_t *  value;
+
+} gBenchOpts[] = {
+    {"yield", &gBenchCfg.yielders}, {"delay", &gBenchCfg.delayers}, {"wait", &gBenchCfg.waiters},  {"delay_ticks", &gBenchCfg.delay},
+    {"stack", &gBenchCfg.stack_size}, {"window", &gBenchCfg.window}, {"max_tasks", &gBenchCfg.max_tasks},
+    {"stackless", &gBenchCfg.stackless}, {"shared", &gBenchCfg.shared},
+};
+
+/**
+ * @brief
+ *   Gets a monotonic time stamp.
+ * @return
+ *   nanoseconds since an arbitrary point in time.
+ */
+
+uint64_t bench_now_ns(void)
+{
+    uint64_t count = HAL_GetPerfCounter();
+    uint64_t freq  = HAL_GetPerfFrequency();
+
+    /* Split the conversion to avoid overflowing 64 bits */
+    return (count / freq) * 1000000000ULL + ((count % freq) * 1000000000ULL) / freq;
+}
+
+/**
+ * @brief
+ *   Clears a samples collector, the buffer is allocated on first use.
+ * @return
+ *   nothing.
+ */
+
+void bench_samples_reset(BENCH_SamplesTypeDef *samples)
+{
+    if ( samples->ns == NULL )
+    {
+        samples->ns       = malloc(sizeof(uint32_t) * BENCH_MAX_SAMPLES);
+        samples->capacity = (samples->ns) ? BENCH_MAX_SAMPLES : 0;
+    }
+
+    samples->count   = 0;
+    samples->stride  = 1;
+    samples->offered = 0;
+}
+
+/**
+ * @brief
+ *   Stores a sample, once the buffer fills up every other sample is dropped
+ *   and only one of every 'stride' new samples is kept, so the distribution is preserved.
+ * @return
+ *   nothing.
+ */
+
+void bench_samples_add(BENCH_SamplesTypeDef *samples, uint64_t ns)
+{
+    uint32_t i;
+
+    if ( samples->capacity == 0 || (samples->offered++ % samples->stride) != 0 )
+        return;
+
+    if ( samples->count == samples->capacity )
+    {
+        for ( i = 0; i < samples->count / 2; i++ )
+            samples->ns[i] = samples->ns[i * 2];
+
+        samples->count /= 2;
+        samples->stride *= 2;
+    }
+
+    samples->ns[samples->count++] = (uint32_t) HAL_MIN(ns, 0xFFFFFFFFULL);
+}
+
+/**
+ * @brief
+ *   qsort() comparator for samples.
+ */
+
+static int bench_compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief
+ *   Gets a percentile of the stored samples, sorting them on the way.
+ * @return
+ *   sample value in nanoseconds, 0 when there are no samples.
+ */
+
+uint32_t bench_samples_percentile(BENCH_SamplesTypeDef *samples, uint32_t percent)
+{
+    uint32_t index;
+
+    if ( samples == NULL || samples->count == 0 )
+        return 0;
+
+    qsort(samples->ns, samples->count, sizeof(uint32_t), bench_compare_u32);
+
+    index = (uint32_t) (((uint64_t) samples->count * percent) / 100);
+    return samples->ns[HAL_MIN(index, samples->count - 1)];
+}
+
+/**
+ * @brief
+ *   Prints a benchmark suite table header.
+ * @return
+ *   nothing.
+ */
+
+void bench_report_header(const char *title)
+{
+    printf("\r\n%s (%d runs, median reported)\r\n", title, gBenchCfg.runs);
+    printf("%-34s%-14s%-12s%-14s%-12s%-12s%-12s%-12s\r\n", "Benchmark", "Ops", "ns/op", "ops/s", "p50 (ns)", "p90 (ns)", "p99 (ns)", "max (ns)");
+    printf("----------------------------------------------------------------------------------------------------------------------\r\n");
+}
+
+/**
+ * @brief
+ *   qsort() comparator for runs, by time per operation.
+ */
+
+static int bench_compare_runs(const void *a, const void *b)
+{
+    const BENCH_RunTypeDef *x = a;
+    const BENCH_RunTypeDef *y = b;
+    double                  p = x->ops ? (double) x->total_ns / x->ops : 0;
+    double                  q = y->ops ? (double) y->total_ns / y->ops : 0;
+
+    return (p > q) - (p < q);
+}
+
+/**
+ * @brief
+ *   Prints a benchmark result line out of its runs and samples.
+ * @return
+ *   nothing.
+ */
+
+void bench_report(const char *name, BENCH_RunTypeDef *runs, int count, BENCH_SamplesTypeDef *samples)
+{
+    BENCH_RunTypeDef *median;
+    double            nsPerOp;
+
+    if ( count <= 0 )
+        return;
+
+    qsort(runs, count, sizeof(BENCH_RunTypeDef), bench_compare_runs);
+    median  = &runs[count / 2];
+    nsPerOp = median->ops ? (double) median->total_ns / median->ops : 0;
+
+    printf("%-34s%-14llu%-12.1f%-14.0f%-12lu%-12lu%-12lu%-12lu\r\n", name, median->ops, nsPerOp, (nsPerOp > 0) ? (1e9 / nsPerOp) : 0,
+           bench_samples_percentile(samples, 50), bench_samples_percentile(samples, 90), bench_samples_percentile(samples, 99),
+           bench_samples_percentile(samples, 100));
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Benchmarks entry point.
+ * @return
+ *   exit code.
+ *
+ *****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    const char *suite = (argc > 1) ? argv[1] : "micro";
+    size_t      len;
+    int         i, o;
+
+    /* Options are given as 'name=value' */
+    for ( i = 2; i < argc; i++ )
+    {
+        len = strcspn(argv[i], "=");
+        if ( argv[i][len] != '=' )
+            continue;
+
+        if ( strncmp(argv[i], "runs", len) == 0 && len == 4 )
+            gBenchCfg.runs = HAL_MAX(1, HAL_MIN(atoi(&argv[i][len + 1]), BENCH_MAX_RUNS));
+
+        for ( o = 0; o < (int) (sizeof(gBenchOpts) / sizeof(gBenchOpts[0])); o++ )
+        {
+            if ( strlen(gBenchOpts[o].name) == len && strncmp(argv[i], gBenchOpts[o].name, len) == 0 )
+                *gBenchOpts[o].value = (uint32_t) strtoul(&argv[i][len + 1], NULL, 0);
+        }
+    }
+
+    /* Keep the numbers repeatable, stay on a single core and avoid being preempted by background work */
+    SetThreadAffinityMask(GetCurrentThread(), 1);
+    SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+
+    HAL_InitTicks();
+
+    if ( strcmp(suite, "micro") == 0 )
+        bench_micro();
+    else if ( strcmp(suite, "stress") == 0 )
+        bench_stress();
+    else
+    {
+        printf("Usage: %s [micro|stress] [runs=n] [yield=%%] [delay=%%] [wait=%%] [delay_ticks=n] [stack=bytes] [window=ticks] [max_tasks=n] [stackless=0|1] [shared=0|1]\r\n", argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
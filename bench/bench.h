@@ -0,0 +1,88 @@
+/**
+ ******************************************************************************
+ * @file    bench.h
+ * @brief   Scheduler benchmarks common definitions.
+ ******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "hal.h"
+#include "scheduler.h"
+
+/** @addtogroup Bench
+ * @{
+ */
+
+#define BENCH_RUNS         (5)       /* Default count of repetitions of each benchmark */
+#define BENCH_MAX_RUNS     (64)      /* Maximum count of repetitions of each benchmark */
+#define BENCH_MAX_SAMPLES  (1 << 16) /* Maximum count of latency samples kept per benchmark */
+#define BENCH_STACK_SIZE   (0x400)   /* Stack allocated for the benchmark tasks */
+
+/* Latency samples collector */
+typedef struct __BENCH_SamplesTypeDef
+{
+    uint32_t *ns;       /* Samples in nanoseconds */
+    uint32_t  count;    /* Samples stored */
+    uint32_t  capacity; /* Buffer capacity */
+    uint32_t  stride;   /* Only one of every 'stride' samples is stored once the buffer was decimated */
+    uint64_t  offered;  /* Samples offered */
+
+} BENCH_SamplesTypeDef;
+
+/* A single benchmark run result */
+typedef struct __BENCH_RunTypeDef
+{
+    uint64_t ops;      /* Operations performed */
+    uint64_t total_ns; /* Time spent on the operations */
+
+} BENCH_RunTypeDef;
+
+/* Benchmark runner settings */
+typedef struct __BENCH_ConfigTypeDef
+{
+    int      runs;       /* Repetitions of each benchmark, the median run is reported */
+    uint32_t yielders;   /* Stress: percentage of tasks looping on taskYIELD() */
+    uint32_t delayers;   /* Stress: percentage of tasks looping on vTaskDelay() */
+    uint32_t waiters;    /* Stress: percentage of tasks looping on xTaskNotifyWait() */
+    uint32_t delay;      /* Stress: delay used by the delaying tasks in ticks */
+    uint32_t stack_size; /* Stress: stack allocated for each task */
+    uint32_t window;     /* Stress: measurement window in ticks */
+    uint32_t max_tasks;  /* Stress: largest task count to try */
+    uint32_t stackless;  /* Stress: create stackless worker tasks when not 0 */
+    uint32_t shared;     /* Stress: create shared stack worker tasks when not 0 */
+
+} BENCH_ConfigTypeDef;
+
+extern BENCH_ConfigTypeDef gBenchCfg;
+
+// clang-format off
+
+uint64_t bench_now_ns(void);
+void     bench_samples_reset(BENCH_SamplesTypeDef *samples);
+void     bench_samples_add(BENCH_SamplesTypeDef *samples, uint64_t ns);
+uint32_t bench_samples_percentile(BENCH_SamplesTypeDef *samples, uint32_t percent);
+void     bench_report_header(const char *title);
+void     bench_report(const char *name, BENCH_RunTypeDef *runs, int count, BENCH_SamplesTypeDef *samples);
+
+/* Benchmark suites */
+void     bench_micro(void);
+void     bench_stress(void);
+
+// clang-format on
+
+/**
+ * @}
+ */
+
+#endif /* BENCH_H */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
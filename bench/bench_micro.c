@@ -0,0 +1,505 @@
+/**
+ ******************************************************************************
+ * @file    bench_micro.c
+ * @brief   Scheduler primitives micro benchmarks.
+ *
+ *  Each benchmark builds its own task set, runs the scheduler until all of
+ *  the tasks have returned and measures:
+ *   - Yield ping-pong between two tasks.
+ *   - Round-robin yield across N tasks.
+ *   - Notify to wake latency.
+ *   - vTaskDelay() accuracy and jitter.
+ *   - Task creation and release cost.
+ *   - Task spawn and exit cost.
+ *   - Stack usage scan cost.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+#include "bench.h"
+
+#define BENCH_PINGPONG_ITERS (200000)  /* Yields performed by each ping-pong task */
+#define BENCH_RR_TOTAL_OPS   (2000000) /* Yields performed across all of the round-robin tasks */
+#define BENCH_NOTIFY_ITERS   (200000)  /* Notifications sent */
+#define BENCH_DELAY_ITERS    (20)      /* Delays performed per requested duration */
+#define BENCH_SPAWN_ITERS    (20000)   /* Tasks spawned */
+#define BENCH_SCAN_ITERS     (2000)    /* Stack scans performed per stack size */
+
+/* State shared by the benchmark tasks */
+typedef struct __BENCH_MicroTypeDef
+{
+    BENCH_SamplesTypeDef samples; /* Latency samples of the running benchmark */
+    BENCH_SamplesTypeDef aux;     /* Secondary samples of the running benchmark */
+    uint64_t             t_start; /* Time the first task was entered */
+    uint64_t             t_end;   /* Time the last task returned */
+    uint64_t             stamp;   /* Time stamp handed from one task to another */
+    uint64_t             ops;     /* Operations performed */
+    uint32_t             iters;   /* Iterations each task should perform */
+    uint32_t             delay;   /* Requested delay in ticks */
+    volatile int         done;    /* Spawned task completion flag */
+    TaskHandle_t         peer;    /* Task to notify */
+
+} BENCH_MicroTypeDef;
+
+/* Round-robin task argument */
+typedef struct __BENCH_RoundRobinTypeDef
+{
+    uint32_t tasks;   /* Tasks taking part in the round-robin */
+    bool     sampler; /* Samples the duration of a full pass, set for one task only */
+
+} BENCH_RoundRobinTypeDef;
+
+static BENCH_MicroTypeDef gMicro;
+
+/**
+ * @brief
+ *   Marks the start of the measured section, the first task to enter sets it.
+ */
+
+static void bench_mark_start(void)
+{
+    if ( gMicro.t_start == 0 )
+        gMicro.t_start = bench_now_ns();
+}
+
+/**
+ * @brief
+ *   Marks the end of the measured section, the last task to return sets it.
+ */
+
+static void bench_mark_end(void)
+{
+    gMicro.t_end = bench_now_ns();
+}
+
+/**
+ * @brief
+ *   Prepares the shared state for a new run.
+ */
+
+static void bench_run_reset(uint32_t iters)
+{
+    gMicro.t_start = 0;
+    gMicro.t_end   = 0;
+    gMicro.stamp   = 0;
+    gMicro.ops     = 0;
+    gMicro.iters   = iters;
+}
+
+/**
+ * @brief
+ *   Collects the result of the last run.
+ */
+
+static void bench_run_collect(BENCH_RunTypeDef *run)
+{
+    run->ops      = gMicro.ops;
+    run->total_ns = (gMicro.t_end > gMicro.t_start) ? (gMicro.t_end - gMicro.t_start) : 0;
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Ping-pong task: yields to its peer, sampling the time it took to get back control.
+ *****************************************************************************/
+
+static void bench_pingpong_task(void *args)
+{
+    uint32_t i;
+    uint64_t now;
+
+    bench_mark_start();
+
+    for ( i = 0; i < gMicro.iters; i++ )
+    {
+        gMicro.stamp = bench_now_ns();
+        taskYIELD();
+
+        /* The peer stamped right before yielding back to us */
+        now = bench_now_ns();
+        bench_samples_add(&gMicro.samples, now - gMicro.stamp);
+        gMicro.ops++;
+    }
+
+    bench_mark_end();
+}
+
+static void bench_pingpong(void)
+{
+    BENCH_RunTypeDef runs[BENCH_MAX_RUNS];
+    int              r;
+
+    bench_samples_reset(&gMicro.samples);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        bench_run_reset(BENCH_PINGPONG_ITERS);
+        xTaskCreate("PING", bench_pingpong_task, BENCH_STACK_SIZE, NULL);
+        xTaskCreate("PONG", bench_pingpong_task, BENCH_STACK_SIZE, NULL);
+        vTaskStartScheduler();
+        bench_run_collect(&runs[r]);
+    }
+
+    bench_report("yield ping-pong (2 tasks)", runs, gBenchCfg.runs, &gMicro.samples);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Round-robin task: yields 'iters' times, the first task samples the duration of a full pass.
+ *****************************************************************************/
+
+static void bench_rr_task(void *args)
+{
+    const BENCH_RoundRobinTypeDef *rr = args;
+    uint32_t                       i;
+    uint64_t                       now;
+
+    bench_mark_start();
+
+    for ( i = 0; i < gMicro.iters; i++ )
+    {
+        taskYIELD();
+        gMicro.ops++;
+
+        if ( rr->sampler )
+        {
+            now = bench_now_ns();
+            if ( gMicro.stamp )
+                bench_samples_add(&gMicro.samples, (now - gMicro.stamp) / rr->tasks);
+
+            gMicro.stamp = now;
+        }
+    }
+
+    bench_mark_end();
+}
+
+static void bench_round_robin(uint32_t tasks)
+{
+    BENCH_RunTypeDef        runs[BENCH_MAX_RUNS];
+    BENCH_RoundRobinTypeDef lead     = {.tasks = tasks, .sampler = true};
+    BENCH_RoundRobinTypeDef follower = {.tasks = tasks, .sampler = false};
+    char                    name[64];
+    uint32_t                i;
+    int                     r;
+
+    bench_samples_reset(&gMicro.samples);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        bench_run_reset(HAL_MAX(1, BENCH_RR_TOTAL_OPS / tasks));
+
+        for ( i = 0; i < tasks; i++ )
+        {
+            if ( xTaskCreate("RR", bench_rr_task, BENCH_STACK_SIZE, (i == 0) ? &lead : &follower) == HAL_XTASK_INVALID_HANDLE )
+            {
+                printf("round-robin: out of memory after %lu tasks\r\n", i);
+                break;
+            }
+        }
+
+        vTaskStartScheduler();
+        bench_run_collect(&runs[r]);
+    }
+
+    snprintf(name, sizeof(name), "yield round-robin (%lu tasks)", tasks);
+    bench_report(name, runs, gBenchCfg.runs, &gMicro.samples);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Notify benchmark: the waiter samples the time since the notifier stamped and signaled it.
+ *****************************************************************************/
+
+static void bench_waiter_task(void *args)
+{
+    uint32_t i;
+
+    for ( i = 0; i < gMicro.iters; i++ )
+    {
+        xTaskNotifyWait(HAL_XTASK_MAX_TIME);
+        bench_samples_add(&gMicro.samples, bench_now_ns() - gMicro.stamp);
+        gMicro.ops++;
+    }
+
+    bench_mark_end();
+}
+
+static void bench_notifier_task(void *args)
+{
+    uint32_t i;
+
+    bench_mark_start();
+
+    for ( i = 0; i < gMicro.iters; i++ )
+    {
+        gMicro.stamp = bench_now_ns();
+        xTaskNotify(gMicro.peer, 1);
+        taskYIELD();
+    }
+}
+
+static void bench_notify(void)
+{
+    BENCH_RunTypeDef runs[BENCH_MAX_RUNS];
+    int              r;
+
+    bench_samples_reset(&gMicro.samples);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        bench_run_reset(BENCH_NOTIFY_ITERS);
+
+        /* The waiter is created first so it is already blocked once the notifier starts */
+        gMicro.peer = xTaskCreate("WAITER", bench_waiter_task, BENCH_STACK_SIZE, NULL);
+        xTaskCreate("NOTIFIER", bench_notifier_task, BENCH_STACK_SIZE, NULL);
+        vTaskStartScheduler();
+        bench_run_collect(&runs[r]);
+    }
+
+    bench_report("notify -> wake", runs, gBenchCfg.runs, &gMicro.samples);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Delay benchmark: samples the actual time spent in vTaskDelay().
+ *****************************************************************************/
+
+static void bench_delay_task(void *args)
+{
+    uint32_t i;
+    uint64_t t;
+
+    bench_mark_start();
+
+    for ( i = 0; i < gMicro.iters; i++ )
+    {
+        t = bench_now_ns();
+        vTaskDelay(gMicro.delay);
+        t = bench_now_ns() - t;
+
+        bench_samples_add(&gMicro.samples, t);
+        gMicro.ops++;
+    }
+
+    bench_mark_end();
+}
+
+static void bench_delay(uint32_t delay)
+{
+    BENCH_RunTypeDef runs[BENCH_MAX_RUNS];
+    char             name[64];
+    int              r;
+
+    bench_samples_reset(&gMicro.samples);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        bench_run_reset(BENCH_DELAY_ITERS);
+        gMicro.delay = delay;
+        xTaskCreate("DELAY", bench_delay_task, BENCH_STACK_SIZE, NULL);
+        vTaskStartScheduler();
+        bench_run_collect(&runs[r]);
+    }
+
+    snprintf(name, sizeof(name), "vTaskDelay(%lu) elapsed", delay);
+    bench_report(name, runs, gBenchCfg.runs, &gMicro.samples);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Spawn benchmark: a task repeatedly spawns a child and waits until it has returned.
+ *****************************************************************************/
+
+static void bench_child_task(void *args)
+{
+    gMicro.done = true;
+}
+
+static void bench_spawner_task(void *args)
+{
+    uint32_t i;
+    uint64_t t;
+
+    bench_mark_start();
+
+    for ( i = 0; i < gMicro.iters; i++ )
+    {
+        gMicro.done = false;
+
+        t = bench_now_ns();
+        if ( xTaskCreate("CHILD", bench_child_task, BENCH_STACK_SIZE, NULL) == HAL_XTASK_INVALID_HANDLE )
+            break;
+
+        /* The child runs, returns and is released within the next scheduler pass */
+        while ( gMicro.done == false )
+            taskYIELD();
+
+        taskYIELD();
+
+        bench_samples_add(&gMicro.samples, bench_now_ns() - t);
+        gMicro.ops++;
+    }
+
+    bench_mark_end();
+}
+
+static void bench_spawn(void)
+{
+    BENCH_RunTypeDef runs[BENCH_MAX_RUNS];
+    int              r;
+
+    bench_samples_reset(&gMicro.samples);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        bench_run_reset(BENCH_SPAWN_ITERS);
+        xTaskCreate("SPAWNER", bench_spawner_task, BENCH_STACK_SIZE, NULL);
+        vTaskStartScheduler();
+        bench_run_collect(&runs[r]);
+    }
+
+    bench_report("task spawn -> run -> exit", runs, gBenchCfg.runs, &gMicro.samples);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Create and release benchmark: tasks are created in a scheduler instance of
+ *  their own, which is then deleted along with them. The tasks never run, so
+ *  only the creation and the release of a task are measured.
+ *****************************************************************************/
+
+static void bench_create_release(void)
+{
+    BENCH_RunTypeDef  create[BENCH_MAX_RUNS];
+    BENCH_RunTypeDef  release[BENCH_MAX_RUNS];
+    SchedulerHandle_t sched;
+    uint32_t          i;
+    uint64_t          t;
+    int               r;
+
+    bench_samples_reset(&gMicro.samples);
+    bench_samples_reset(&gMicro.aux);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        sched = xSchedulerCreate();
+        if ( sched == HAL_XSCHED_INVALID_HANDLE )
+            return;
+
+        create[r].ops      = 0;
+        create[r].total_ns = 0;
+
+        for ( i = 0; i < BENCH_SPAWN_ITERS; i++ )
+        {
+            t = bench_now_ns();
+            if ( xTaskCreateOn(sched, "CREATED", bench_child_task, BENCH_STACK_SIZE, NULL) == HAL_XTASK_INVALID_HANDLE )
+                break;
+
+            t = bench_now_ns() - t;
+            bench_samples_add(&gMicro.samples, t);
+            create[r].total_ns += t;
+            create[r].ops++;
+        }
+
+        /* The instance releases its tasks one by one, only the average is known */
+        t = bench_now_ns();
+        vSchedulerDelete(sched);
+        t = bench_now_ns() - t;
+
+        release[r].ops      = create[r].ops;
+        release[r].total_ns = t;
+
+        if ( create[r].ops > 0 )
+            bench_samples_add(&gMicro.aux, t / create[r].ops);
+    }
+
+    bench_report("xTaskCreate", create, gBenchCfg.runs, &gMicro.samples);
+    bench_report("task release (average per run)", release, gBenchCfg.runs, &gMicro.aux);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Stack scan benchmark: measures xTaskGetStackUsage() over a never used
+ *  (hence fully scanned) stack.
+ *****************************************************************************/
+
+static void bench_idle_task(void *args)
+{
+}
+
+static void bench_stack_scan(uint32_t stackSize)
+{
+    BENCH_RunTypeDef runs[BENCH_MAX_RUNS];
+    char             name[64];
+    TaskHandle_t     handle;
+    uint32_t         i;
+    uint64_t         t;
+    int              r;
+
+    bench_samples_reset(&gMicro.samples);
+
+    for ( r = 0; r < gBenchCfg.runs; r++ )
+    {
+        handle = xTaskCreate("SCAN", bench_idle_task, stackSize, NULL);
+        if ( handle == HAL_XTASK_INVALID_HANDLE )
+            return;
+
+        runs[r].ops      = BENCH_SCAN_ITERS;
+        runs[r].total_ns = bench_now_ns();
+
+        for ( i = 0; i < BENCH_SCAN_ITERS; i++ )
+        {
+            t = bench_now_ns();
+            xTaskGetStackUsage(handle);
+            bench_samples_add(&gMicro.samples, bench_now_ns() - t);
+        }
+
+        runs[r].total_ns = bench_now_ns() - runs[r].total_ns;
+
+        /* Let the task run and return so it is released */
+        vTaskStartScheduler();
+    }
+
+    snprintf(name, sizeof(name), "stack usage scan (%lu bytes)", stackSize);
+    bench_report(name, runs, gBenchCfg.runs, &gMicro.samples);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Micro benchmarks suite.
+ *****************************************************************************/
+
+void bench_micro(void)
+{
+    static const uint32_t rrTasks[]    = {2, 100, 1000, 10000, 100000};
+    static const uint32_t delays[]     = {1, 10, 50};
+    static const uint32_t stackSizes[] = {0x400, 0x3000, 0x10000};
+    int                   i;
+
+    bench_report_header("Scheduler primitives");
+
+    bench_pingpong();
+
+    for ( i = 0; i < (int) (sizeof(rrTasks) / sizeof(rrTasks[0])); i++ )
+        bench_round_robin(rrTasks[i]);
+
+    bench_notify();
+
+    for ( i = 0; i < (int) (sizeof(delays) / sizeof(delays[0])); i++ )
+        bench_delay(delays[i]);
+
+    bench_create_release();
+    bench_spawn();
+
+    for ( i = 0; i < (int) (sizeof(stackSizes) / sizeof(stackSizes[0])); i++ )
+        bench_stack_scan(stackSizes[i]);
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
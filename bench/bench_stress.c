@@ -0,0 +1,314 @@
+/**
+ ******************************************************************************
+ * @file    bench_stress.c
+ * @brief   Scheduler scalability benchmark.
+ *
+ *  Creates growing task sets (1k, 10k, 100k and 1M tasks) made of a configurable
+ *  mix of yielding, delaying and notification waiting tasks, runs the scheduler
+ *  for a fixed window and reports per size:
+ *   - Task creation time.
+ *   - Memory committed per task.
+ *   - Context switches per second.
+ *   - Duration of a full scheduler pass over all of the tasks.
+ *  A size that cannot be created is reported and ends the suite. The workers can
+ *  be made stackless or run on the shared stack to compare the task kinds.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+#include "bench.h"
+#include "stackless.h"
+
+#include <psapi.h> /* Must follow Windows.h */
+
+/* State shared by the stress tasks */
+typedef struct __BENCH_StressTypeDef
+{
+    BENCH_SamplesTypeDef passes;   /* Full scheduler pass durations */
+    uint64_t             switches; /* Context switches performed by the worker tasks */
+    uint64_t             t_start;  /* Measurement window start */
+    uint64_t             t_end;    /* Measurement window end */
+    TaskHandle_t *       waiters;  /* Handles of the notification waiting tasks */
+    uint32_t             count;    /* Count of waiting tasks */
+    uint32_t             next;     /* Next waiting task to notify */
+
+} BENCH_StressTypeDef;
+
+static BENCH_StressTypeDef gStress;
+
+/**
+ * @brief
+ *   Gets the memory committed by the process.
+ * @return
+ *   bytes.
+ */
+
+static uint64_t bench_private_bytes(void)
+{
+    PROCESS_MEMORY_COUNTERS_EX counters;
+
+    if ( GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS *) &counters, sizeof(counters)) == FALSE )
+        return 0;
+
+    return counters.PrivateUsage;
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Controller task: created first, hence runs exactly once per scheduler pass.
+ *  Samples each pass duration and ends the scheduler once the window is over.
+ *****************************************************************************/
+
+static void bench_controller_task(void *args)
+{
+    uint64_t window = (uint64_t) gBenchCfg.window * 1000000ULL;
+    uint64_t last, now;
+
+    gStress.t_start = last = bench_now_ns();
+
+    do
+    {
+        taskYIELD();
+
+        now = bench_now_ns();
+        bench_samples_add(&gStress.passes, now - last);
+        last = now;
+
+    } while ( (now - gStress.t_start) < window );
+
+    gStress.t_end = now;
+    vTaskEndScheduler();
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Yielding task: signals the next waiting task and yields.
+ *****************************************************************************/
+
+static void bench_yielder_task(void *args)
+{
+    while ( 1 )
+    {
+        if ( gStress.count > 0 )
+            xTaskNotify(gStress.waiters[gStress.next++ % gStress.count], 1);
+
+        taskYIELD();
+        gStress.switches++;
+    }
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Delaying task: sleeps for the configured delay over and over.
+ *****************************************************************************/
+
+static void bench_delayer_task(void *args)
+{
+    while ( 1 )
+    {
+        vTaskDelay(gBenchCfg.delay);
+        gStress.switches++;
+    }
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Waiting task: waits for notifications sent by the yielding tasks.
+ *****************************************************************************/
+
+static void bench_waiter_task(void *args)
+{
+    while ( 1 )
+    {
+        xTaskNotifyWait(HAL_XTASK_MAX_TIME);
+        gStress.switches++;
+    }
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Stackless yielding task.
+ *****************************************************************************/
+
+static XTask_PtState bench_pt_yielder_task(XTask_PtTypeDef *pt, void *args)
+{
+    XPT_BEGIN(pt);
+
+    while ( 1 )
+    {
+        if ( gStress.count > 0 )
+            xTaskNotify(gStress.waiters[gStress.next++ % gStress.count], 1);
+
+        XPT_YIELD(pt);
+        gStress.switches++;
+    }
+
+    XPT_END(pt);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Stackless delaying task.
+ *****************************************************************************/
+
+static XTask_PtState bench_pt_delayer_task(XTask_PtTypeDef *pt, void *args)
+{
+    XPT_BEGIN(pt);
+
+    while ( 1 )
+    {
+        XPT_DELAY(pt, gBenchCfg.delay);
+        gStress.switches++;
+    }
+
+    XPT_END(pt);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Stackless waiting task.
+ *****************************************************************************/
+
+static XTask_PtState bench_pt_waiter_task(XTask_PtTypeDef *pt, void *args)
+{
+    uint32_t events;
+
+    XPT_BEGIN(pt);
+
+    while ( 1 )
+    {
+        XPT_WAIT_NOTIFY(pt, HAL_XTASK_MAX_TIME, events);
+        gStress.switches++;
+    }
+
+    XPT_END(pt);
+}
+
+/**
+ * @brief
+ *   Builds a task set of the requested size, runs it and prints a result line.
+ * @return
+ *   true when the task set was fully created.
+ */
+
+static bool bench_stress_size(uint32_t tasks)
+{
+    uint32_t       weight = gBenchCfg.yielders + gBenchCfg.delayers + gBenchCfg.waiters;
+    uint32_t       created, slot;
+    uint64_t       mem, t;
+    double         createNs, memPerTask, seconds;
+    TaskHandle_t        handle;
+    TaskFunction_t      fn;
+    StacklessFunction_t ptFn;
+
+    if ( weight == 0 )
+        weight = gBenchCfg.yielders = 100;
+
+    bench_samples_reset(&gStress.passes);
+    gStress.switches = 0;
+    gStress.count    = 0;
+    gStress.next     = 0;
+    gStress.waiters  = malloc(sizeof(TaskHandle_t) * tasks);
+
+    if ( gStress.waiters == NULL )
+        return false;
+
+    mem = bench_private_bytes();
+    t   = bench_now_ns();
+
+    xTaskCreate("CONTROL", bench_controller_task, BENCH_STACK_SIZE, NULL);
+
+    /* Interleave the task kinds according to their weights */
+    for ( created = 0; created < tasks; created++ )
+    {
+        slot = created % weight;
+
+        if ( slot < gBenchCfg.yielders )
+        {
+            fn   = bench_yielder_task;
+            ptFn = bench_pt_yielder_task;
+        }
+        else if ( slot < gBenchCfg.yielders + gBenchCfg.delayers )
+        {
+            fn   = bench_delayer_task;
+            ptFn = bench_pt_delayer_task;
+        }
+        else
+        {
+            fn   = bench_waiter_task;
+            ptFn = bench_pt_waiter_task;
+        }
+
+        if ( gBenchCfg.stackless )
+            handle = xTaskCreateStackless(ptFn, NULL);
+        else if ( gBenchCfg.shared )
+            handle = xTaskCreateShared("STRESS", fn, NULL);
+        else
+            handle = xTaskCreate("STRESS", fn, gBenchCfg.stack_size, NULL);
+
+        if ( handle == HAL_XTASK_INVALID_HANDLE )
+            break;
+
+        if ( fn == bench_waiter_task )
+            gStress.waiters[gStress.count++] = handle;
+    }
+
+    t   = bench_now_ns() - t;
+    mem = bench_private_bytes() - mem;
+
+    createNs   = created ? (double) t / created : 0;
+    memPerTask = created ? (double) mem / created : 0;
+
+    if ( created < tasks )
+    {
+        printf("%-12lu%-12lu%-16.0f%-16.0f%s\r\n", tasks, created, createNs, memPerTask, "creation failed, out of memory");
+        /* Release the tasks created so far, a scheduler asked to end before starting only cleans up */
+        vTaskEndScheduler();
+        vTaskStartScheduler();
+        free(gStress.waiters);
+        return false;
+    }
+
+    vTaskStartScheduler();
+
+    seconds = (double) (gStress.t_end - gStress.t_start) / 1e9;
+
+    printf("%-12lu%-12lu%-16.0f%-16.0f%-16.0f%-14.1f%-14.1f%-14.1f\r\n", tasks, created, createNs, memPerTask,
+           (seconds > 0) ? (gStress.switches / seconds) : 0, bench_samples_percentile(&gStress.passes, 50) / 1000.0,
+           bench_samples_percentile(&gStress.passes, 99) / 1000.0, (double) bench_samples_percentile(&gStress.passes, 50) / tasks);
+
+    free(gStress.waiters);
+    return true;
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Scalability benchmarks suite.
+ *****************************************************************************/
+
+void bench_stress(void)
+{
+    uint32_t tasks;
+
+    printf("\r\nScalability: %lu%% yielding, %lu%% delaying (%lu ticks), %lu%% waiting, %lu bytes stack%s, %lu ticks window\r\n",
+           gBenchCfg.yielders, gBenchCfg.delayers, gBenchCfg.delay, gBenchCfg.waiters, gBenchCfg.stack_size,
+           gBenchCfg.stackless ? " (stackless workers)" : (gBenchCfg.shared ? " (shared stack workers)" : ""), gBenchCfg.window);
+    printf("%-12s%-12s%-16s%-16s%-16s%-14s%-14s%-14s\r\n", "Tasks", "Created", "Create (ns)", "Memory (B)", "Switches/s", "Pass p50 (us)",
+           "Pass p99 (us)", "ns/task/pass");
+    printf("----------------------------------------------------------------------------------------------------------------------\r\n");
+
+    for ( tasks = 1000; tasks <= gBenchCfg.max_tasks; tasks *= 10 )
+    {
+        if ( bench_stress_size(tasks) == false )
+            break;
+    }
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
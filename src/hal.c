@@ -18,10 +18,17 @@
 /* Includes ------------------------------------------------------------------*/
 #include "hal.h"
 #include "ansi.h"
+#include "logger.h"
+
+#include <intrin.h>
 
 /* Global system start tick value */
 uint32_t gStartTick = 0;
 
+/* Active time source and the current virtual time */
+HAL_TimeSource gTimeSource  = HAL_TimeSource_Real;
+uint32_t       gVirtualTick = 0;
+
 /**
  * @brief
  *   Initializes the ticks counter. 
@@ -42,10 +49,123 @@ void HAL_InitTicks(void)
 
 uint32_t HAL_GetTick(void)
 {
+    if ( gTimeSource == HAL_TimeSource_Virtual )
+        return gVirtualTick;
 
     return GetTickCount() - gStartTick;
 }
 
+/**
+ * @brief
+ *   Selects the time source. A virtual clock starts at 0 and only moves
+ *   when explicitly advanced, or when a delay is requested.
+ * @param source: time source.
+ * @return
+ *   nothing.
+ */
+
+void HAL_SetTimeSource(HAL_TimeSource source)
+{
+    gTimeSource  = source;
+    gVirtualTick = 0;
+}
+
+/**
+ * @brief
+ *   Checks whether the virtual time source is active.
+ * @return
+ *   boolean.
+ */
+
+bool HAL_IsVirtualTime(void)
+{
+    return (gTimeSource == HAL_TimeSource_Virtual);
+}
+
+/**
+ * @brief
+ *   Moves the virtual clock forward to the given tick, never backward.
+ * @param tick: target tick value.
+ * @return
+ *   nothing.
+ */
+
+void HAL_AdvanceTicks(uint32_t tick)
+{
+    if ( gTimeSource == HAL_TimeSource_Virtual && tick > gVirtualTick )
+        gVirtualTick = tick;
+}
+
+/**
+ * @brief  Provides the high resolution performance counter value.
+ * @note   Use HAL_GetPerfFrequency() to convert counts to time.
+ * @retval counter value
+ */
+
+uint64_t HAL_GetPerfCounter(void)
+{
+    LARGE_INTEGER count;
+
+    QueryPerformanceCounter(&count);
+    return (uint64_t) count.QuadPart;
+}
+
+/**
+ * @brief  Provides the high resolution performance counter frequency.
+ * @retval counts per second
+ */
+
+uint64_t HAL_GetPerfFrequency(void)
+{
+    static uint64_t frequency = 0;
+    LARGE_INTEGER   freq;
+
+    /* The frequency is fixed at system boot, query it only once */
+    if ( frequency == 0 )
+    {
+        QueryPerformanceFrequency(&freq);
+        frequency = (uint64_t) freq.QuadPart;
+    }
+
+    return frequency;
+}
+
+/**
+ * @brief  Provides the CPU time stamp counter value, cheaper to read than the performance counter.
+ * @note   Use HAL_GetCycleFrequency() to convert cycles to time.
+ * @retval cycles count
+ */
+
+uint64_t HAL_GetCycles(void)
+{
+    return __rdtsc();
+}
+
+/**
+ * @brief  Provides the time stamp counter frequency, measured against the performance
+ *         counter over 10 milliseconds on the first call.
+ * @retval cycles per second
+ */
+
+uint64_t HAL_GetCycleFrequency(void)
+{
+    static uint64_t frequency = 0;
+    uint64_t        counter, cycles, span;
+
+    if ( frequency == 0 )
+    {
+        counter = HAL_GetPerfCounter();
+        cycles  = HAL_GetCycles();
+
+        while ( (span = HAL_GetPerfCounter() - counter) < HAL_GetPerfFrequency() / 100 )
+            ;
+
+        frequency = (HAL_GetCycles() - cycles) * HAL_GetPerfFrequency() / span;
+    }
+
+    return frequency;
+}
+
 /**
  * @brief This function provides accurate delay (in milliseconds) based
  *        on TIMER0 counter read.
@@ -55,7 +175,10 @@ uint32_t HAL_GetTick(void)
 
 void HAL_Delay(uint16_t ticks)
 {
-    Sleep(ticks);
+    if ( gTimeSource == HAL_TimeSource_Virtual )
+        gVirtualTick += ticks;
+    else
+        Sleep(ticks);
 }
 
 /**
@@ -100,67 +223,20 @@ __declspec(naked) void *HAL_GetStackPointer(void)
 
 /**
  * @brief
- *   Printf coupled with time
+ *   Printf coupled with time and color, the line is written asynchronously by the logger.
  * @param
  *   printf style input
- * @return count of bytes printed.
+ * @return count of bytes printed, -1 when the line was dropped.
  */
 
 int printf_c(HAL_TermColor color, const char *format, ...)
 {
-    static lines = 0;
-    va_list         list;
-    char            localBuff[1024] = {0};
-    int             size            = -1;
-    HAL_TimeTypeDef timestamp;
-
-    do
-    {
-
-        if ( ! format ) // Module was not initialized
-            break;
-
-        if ( lines == 25 )
-        {
-            system("cls");
-            lines = 0;
-        }
-
-        HAL_TicksToTime(&timestamp, 0);
-
-        // Construct the message
-        va_start(list, format);
-        size = vsnprintf(localBuff, sizeof(localBuff) - 1, format, list);
-        va_end(list);
-
-        if ( size < 0 )
-            break;
-
-        printf("[%02d.%02d:%02d:%02d.%03d] ", timestamp.days, timestamp.hours, timestamp.minutes, timestamp.seconds, (int) timestamp.msecs);
-
-        switch ( color )
-        {
-            case Color_White:
-                printf(ANSI_MODE);
-                break;
-            case Color_Red:
-                printf(ANSI_RED);
-                break;
-            case Color_Green:
-                printf(ANSI_GREEN);
-                break;
-            case Color_Blue:
-                printf(ANSI_BLUE);
-                break;
-            case Color_Yellow:
-                printf(ANSI_YELLOW);
-                break;
-        }
-
-        printf("%s\r\n" ANSI_MODE, localBuff);
-    } while ( 0 );
+    va_list list;
+    int     size;
 
-    lines++;
+    va_start(list, format);
+    size = xLogPrintV(color, format, list);
+    va_end(list);
 
     return size;
 }
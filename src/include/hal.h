@@ -21,9 +21,14 @@
 #include <conio.h>
 #include <malloc.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /** @addtogroup HAL
  * @{
  */
@@ -43,6 +48,13 @@ typedef struct __HAL_TimeTypeDef
 
 } HAL_TimeTypeDef;
 
+typedef enum
+{
+    HAL_TimeSource_Real,    /*!< Ticks follow the system clock */
+    HAL_TimeSource_Virtual, /*!< Ticks only move when advanced, see HAL_AdvanceTicks() */
+
+} HAL_TimeSource;
+
 typedef enum
 {
     Color_White,
@@ -57,6 +69,13 @@ typedef enum
 
 void     HAL_InitTicks(void);
 uint32_t HAL_GetTick(void);
+void     HAL_SetTimeSource(HAL_TimeSource source);
+bool     HAL_IsVirtualTime(void);
+void     HAL_AdvanceTicks(uint32_t tick);
+uint64_t HAL_GetPerfCounter(void);
+uint64_t HAL_GetPerfFrequency(void);
+uint64_t HAL_GetCycles(void);
+uint64_t HAL_GetCycleFrequency(void);
 void     HAL_TicksToTime(HAL_TimeTypeDef *time, uint32_t ms);
 void     HAL_Delay(uint16_t ticks);
 void     HAL_Pause(char *str, char expected);
@@ -70,6 +89,10 @@ int printf_c(HAL_TermColor color, const char *format, ...);
  * @}
  */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* WIN_WRAPPER_H */
 
 /************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
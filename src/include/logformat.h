@@ -0,0 +1,377 @@
+/**
+ ******************************************************************************
+ * @file    logformat.h
+ * @brief
+ *
+ *  Deferred log records layout.
+ *  A deferred log line is recorded as the id of its format string, a time stamp
+ *  and the raw bytes of its arguments, formatting happens later on, either in the
+ *  logger thread or offline by the logdecode tool reading a binary log file.
+ *  This header is shared by both sides, it only depends on the C library.
+ *
+ *  Argument encoding, in the order of the format conversions:
+ *  - '*' widths and precisions, and int sized integers: 4 bytes.
+ *  - 'l', 'll', 'I64', 'j', 'z', 't' and 'I' integers: 8 bytes, sign or zero extended.
+ *  - Floating point values: 8 bytes double.
+ *  - Pointers: 8 bytes.
+ *  - Strings: 16 bits length followed by the characters, no terminator.
+ *  Wide characters and strings and '%n' are not supported.
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XLOGFMT_
+#define LV662_HAL_XLOGFMT_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup XLogger
+ * @{
+ */
+
+#define XLOG_FILE_MAGIC   (0x474F4C58) /* "XLOG" */
+#define XLOG_FILE_VERSION (1)          /* Binary log file layout version */
+#define XLOG_ID_FORMAT    (0x0000)     /* Entry defining a format string */
+#define XLOG_ID_WRAP      (0xFFFF)     /* Ring buffer padding, the next record starts at the ring start */
+#define XLOG_MAX_ARGS     (16)         /* Maximum count of encoded arguments of a format */
+#define XLOG_MAX_STRING   (64)         /* Maximum characters recorded for a string argument */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup XLOGFMT_Exported_Macros XLogger Format Exported Macros
+ * @{
+ */
+
+/* How an argument is read by the call site and encoded */
+typedef enum
+{
+    XLogArg_Int,         /*!< int */
+    XLogArg_Long,        /*!< long */
+    XLogArg_LongLong,    /*!< long long */
+    XLogArg_Size,        /*!< size_t */
+    XLogArg_Double,      /*!< double */
+    XLogArg_Pointer,     /*!< void * */
+    XLogArg_String,      /*!< char * */
+    XLogArg_None,        /*!< '%%', no argument */
+    XLogArg_Unsupported, /*!< Not supported by the deferred encoding */
+
+} XLog_ArgType;
+
+/* Parsed conversion specification */
+typedef struct
+{
+    const char * prefix;     /*!< Flags, width and precision, following the '%' */
+    uint32_t     prefix_len; /*!< Characters in 'prefix' */
+    const char * length;     /*!< Length modifier */
+    uint32_t     length_len; /*!< Characters in 'length' */
+    uint32_t     stars;      /*!< Count of '*' width and precision arguments */
+    uint8_t      is_signed;  /*!< Signed integer conversion */
+    char         conv;       /*!< Conversion character */
+    XLog_ArgType type;       /*!< Argument type */
+
+} XLog_SpecTypeDef;
+
+/* Binary log file header, the entries follow */
+typedef struct
+{
+    uint32_t magic;     /*!< XLOG_FILE_MAGIC */
+    uint32_t version;   /*!< XLOG_FILE_VERSION */
+    uint32_t tick;      /*!< Tick value when the file was opened */
+    uint32_t cycles_lo; /*!< Cycle counter value when the file was opened, the tick value under virtual time */
+    uint32_t cycles_hi;
+    uint32_t freq_lo;   /*!< Cycle counter frequency, 1000 under virtual time */
+    uint32_t freq_hi;
+
+} XLog_FileHeaderTypeDef;
+
+/* Log record, followed by the encoded arguments. 'size' includes the header and is a multiple of 4 */
+typedef struct
+{
+    uint16_t id;        /*!< Format id */
+    uint16_t size;      /*!< Record bytes */
+    uint32_t cycles_lo; /*!< Cycle counter value the line was logged at, the tick value under virtual time */
+    uint32_t cycles_hi;
+
+} XLog_RecordHeaderTypeDef;
+
+/* Format definition, followed by the format string and its terminator. Written before the first record using the format */
+typedef struct
+{
+    uint16_t id;        /*!< XLOG_ID_FORMAT */
+    uint16_t size;      /*!< Entry bytes, a multiple of 4 */
+    uint16_t format_id; /*!< Id defined */
+    uint16_t color;     /*!< Line color, HAL_TermColor */
+
+} XLog_FormatHeaderTypeDef;
+
+/**
+ * @}
+ */
+
+/**
+ * @brief Parses the conversion specification starting at a '%'.
+ * @retval Count of characters parsed, 0 when the specification is incomplete.
+ */
+
+static inline int xLogParseSpec(const char *p, XLog_SpecTypeDef *spec)
+{
+    const char *s = p + 1;
+
+    memset(spec, 0, sizeof(XLog_SpecTypeDef));
+    spec->prefix = s;
+
+    while ( *s && strchr("-+ #0", *s) )
+        s++;
+
+    if ( *s == '*' )
+        s++, spec->stars++;
+    else
+        while ( *s >= '0' && *s <= '9' )
+            s++;
+
+    if ( *s == '.' )
+    {
+        s++;
+        if ( *s == '*' )
+            s++, spec->stars++;
+        else
+            while ( *s >= '0' && *s <= '9' )
+                s++;
+    }
+
+    spec->prefix_len = (uint32_t) (s - spec->prefix);
+    spec->length     = s;
+    spec->type       = XLogArg_Int;
+
+    if ( s[0] == 'h' )
+        s += (s[1] == 'h') ? 2 : 1;
+    else if ( s[0] == 'l' && s[1] == 'l' )
+        s += 2, spec->type = XLogArg_LongLong;
+    else if ( s[0] == 'l' )
+        s += 1, spec->type = XLogArg_Long;
+    else if ( s[0] == 'I' && s[1] == '6' && s[2] == '4' )
+        s += 3, spec->type = XLogArg_LongLong;
+    else if ( s[0] == 'I' && s[1] == '3' && s[2] == '2' )
+        s += 3;
+    else if ( s[0] == 'j' )
+        s += 1, spec->type = XLogArg_LongLong;
+    else if ( s[0] == 'z' || s[0] == 't' || s[0] == 'I' )
+        s += 1, spec->type = XLogArg_Size;
+    else if ( s[0] == 'L' )
+        s += 1;
+
+    spec->length_len = (uint32_t) (s - spec->length);
+    spec->conv       = *s;
+
+    switch ( spec->conv )
+    {
+        case 0:
+            return 0;
+
+        case '%':
+            spec->type = XLogArg_None;
+            break;
+
+        case 'd':
+        case 'i':
+            spec->is_signed = 1;
+            break;
+
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            break;
+
+        case 'c':
+            if ( spec->type != XLogArg_Int || (spec->length_len && spec->length[0] != 'h') )
+                spec->type = XLogArg_Unsupported;
+            break;
+
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec->type = XLogArg_Double;
+            break;
+
+        case 'p':
+            spec->type = XLogArg_Pointer;
+            break;
+
+        case 's':
+            spec->type = (spec->length_len == 0) ? XLogArg_String : XLogArg_Unsupported;
+            break;
+
+        default:
+            spec->type = XLogArg_Unsupported;
+            break;
+    }
+
+    return (int) (s + 1 - p);
+}
+
+/**
+ * @brief Formats a deferred record, the same way printf() formats the original call.
+ * @param args: encoded arguments, see the file header.
+ * @param len: bytes in 'args'.
+ * @retval Count of characters written to 'buf', excluding the terminator.
+ */
+
+static inline int xLogFormatArgs(char *buf, size_t size, const char *format, const uint8_t *args, uint32_t len)
+{
+    XLog_SpecTypeDef spec;
+    const char *     p   = format;
+    size_t           off = 0;
+    char             fmt[64];
+    char             str[XLOG_MAX_STRING + 1];
+    uint32_t         pos = 0, i, n;
+    int32_t          i32;
+    int64_t          i64;
+    double           dbl;
+    uint16_t         slen;
+    int              ret, used;
+
+    if ( size == 0 )
+        return 0;
+
+    buf[0] = 0;
+
+    while ( *p && off + 1 < size )
+    {
+        if ( *p != '%' )
+        {
+            buf[off++] = *p++;
+            continue;
+        }
+
+        used = xLogParseSpec(p, &spec);
+        if ( used == 0 || spec.type == XLogArg_Unsupported )
+            break;
+
+        p += used;
+        if ( spec.type == XLogArg_None )
+        {
+            buf[off++] = '%';
+            continue;
+        }
+
+        /* Rebuild the specification, the '*' replaced by their values and the length by the encoded size */
+        n = 0;
+        fmt[n++] = '%';
+        for ( i = 0; i < spec.prefix_len && n < sizeof(fmt) - 16; i++ )
+        {
+            if ( spec.prefix[i] != '*' )
+            {
+                fmt[n++] = spec.prefix[i];
+                continue;
+            }
+
+            if ( pos + 4 > len )
+                goto truncated;
+
+            memcpy(&i32, args + pos, 4);
+            pos += 4;
+            n += (uint32_t) snprintf(fmt + n, sizeof(fmt) - n, "%ld", (long) i32);
+        }
+
+        if ( spec.type == XLogArg_Int )
+            for ( i = 0; i < spec.length_len; i++ )
+                fmt[n++] = spec.length[i];
+        else if ( spec.type == XLogArg_Long || spec.type == XLogArg_LongLong || spec.type == XLogArg_Size )
+            fmt[n++] = 'l', fmt[n++] = 'l';
+
+        fmt[n++] = spec.conv;
+        fmt[n]   = 0;
+
+        switch ( spec.type )
+        {
+            case XLogArg_Int:
+                if ( pos + 4 > len )
+                    goto truncated;
+                memcpy(&i32, args + pos, 4);
+                pos += 4;
+                ret = snprintf(buf + off, size - off, fmt, (int) i32);
+                break;
+
+            case XLogArg_Double:
+                if ( pos + 8 > len )
+                    goto truncated;
+                memcpy(&dbl, args + pos, 8);
+                pos += 8;
+                ret = snprintf(buf + off, size - off, fmt, dbl);
+                break;
+
+            case XLogArg_Pointer:
+                if ( pos + 8 > len )
+                    goto truncated;
+                memcpy(&i64, args + pos, 8);
+                pos += 8;
+                ret = snprintf(buf + off, size - off, fmt, (void *) (uintptr_t) i64);
+                break;
+
+            case XLogArg_String:
+                if ( pos + 2 > len )
+                    goto truncated;
+                memcpy(&slen, args + pos, 2);
+                pos += 2;
+                if ( slen > XLOG_MAX_STRING || pos + slen > len )
+                    goto truncated;
+                memcpy(str, args + pos, slen);
+                str[slen] = 0;
+                pos += slen;
+                ret = snprintf(buf + off, size - off, fmt, str);
+                break;
+
+            default:
+                if ( pos + 8 > len )
+                    goto truncated;
+                memcpy(&i64, args + pos, 8);
+                pos += 8;
+                ret = snprintf(buf + off, size - off, fmt, (long long) i64);
+                break;
+        }
+
+        if ( ret < 0 )
+            break;
+
+        off += ((size_t) ret < size - off) ? (size_t) ret : size - off - 1;
+    }
+
+truncated:
+
+    buf[off] = 0;
+    return (int) off;
+}
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LV662_HAL_XLOGFMT_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,116 @@
+/**
+ ******************************************************************************
+ * @file    logger.h
+ * @brief
+ *
+ *  Asynchronous console logger.
+ *  A task logging a line only formats its message into a record of a lock free
+ *  ring buffer, a low priority thread stamps, colors and writes the records in
+ *  batches. Console I/O never runs on a task, and when the ring is full records
+ *  are dropped rather than having the task wait, the logger reports how many.
+ *  Any thread may log, including the worker threads.
+ *
+ *  XLOG() rather defers the formatting itself: the call site only records the id
+ *  of its format string, a time stamp and the raw bytes of its arguments into a
+ *  buffer of the calling thread. The logger thread formats these records, or
+ *  writes them as they are to a binary log file, see xLogSetBinaryFile(), which
+ *  the logdecode tool turns back into text.
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XLOG_
+#define LV662_HAL_XLOG_
+
+#include "hal.h"
+#include "logformat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup XLogger
+ * @{
+ */
+
+#define HAL_XLOG_RECORDS     (256)     /* Ring buffer records, a power of 2 */
+#define HAL_XLOG_MSG_SIZE    (116)     /* Maximum bytes of a message including its terminator, longer ones are truncated */
+#define HAL_XLOG_PERIOD      (10)      /* Milliseconds between two logger thread passes */
+#define HAL_XLOG_BATCH_SIZE  (0x4000)  /* Bytes written to the console at once */
+#define HAL_XLOG_BIN_SIZE    (0x10000) /* Bytes of the deferred records buffer of each thread, a power of 2 */
+#define HAL_XLOG_MAX_FORMATS (1024)    /* Maximum count of XLOG() call sites */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup XLOG_Exported_Macros XLogger Exported Macros
+ * @{
+ */
+
+/* Deferred log call site, set up by XLOG() and completed on its first call */
+typedef struct __XLog_FormatTypeDef
+{
+    const char *  format;               /*!< Format string */
+    HAL_TermColor color;                /*!< Line color */
+    volatile LONG id;                   /*!< Format id, 0 until the first call */
+    uint8_t       types[XLOG_MAX_ARGS]; /*!< XLog_ArgType of each argument, XLOG_ARG_SIGNED set for signed integers */
+    uint8_t       count;                /*!< Count of arguments */
+    uint8_t       written;              /*!< Definition written to the binary log file */
+    uint16_t      max_size;             /*!< Most bytes a record of this format takes */
+
+} XLog_FormatTypeDef;
+
+#define XLOG_ARG_SIGNED (0x80) /* Signed integer flag of XLog_FormatTypeDef.types */
+
+/* Logs a line with a deferred formatting, the format must be a string literal */
+#define XLOG(color, format, ...)                                                      \
+    do                                                                                \
+    {                                                                                 \
+        static XLog_FormatTypeDef xlog_format_ = {format, color};                     \
+        vLogDeferred(&xlog_format_, ##__VA_ARGS__);                                   \
+    } while ( 0 )
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup XLOG_Exported_Functions XLogger Exported Functions
+ * @{
+ */
+
+// clang-format off
+
+int      xLogPrint(HAL_TermColor color, const char *format, ...);
+int      xLogPrintV(HAL_TermColor color, const char *format, va_list list);
+void     vLogDeferred(XLog_FormatTypeDef *format, ...);
+bool     xLogSetBinaryFile(const char *path);
+void     vLogFlush(void);
+uint32_t xLogGetDropped(void);
+
+// clang-format on
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LV662_HAL_XLOG_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -35,6 +35,10 @@
 #include <stdint.h>
 #include <windows.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /** @addtogroup XTasks
  * @{
  */
@@ -43,8 +47,28 @@
 #define HAL_XTASK_MAX_STRING_SIZE    (20)         /* Maximum bytes allowed for a task name */
 #define HAL_XTASK_DEFAULT_STACK_SIZE (0x800)      /* Default stack size  */
 #define HAL_XTASK_INVALID_HANDLE     (0xFFFFFFFF) /* Invalid handle value */
+#define HAL_XSCHED_INVALID_HANDLE    (0xFFFFFFFF) /* Invalid scheduler instance handle value */
 #define HAL_XTASK_COLLECT_STATS      (1)          /* Collect run time statitics */
 #define HAL_XTASK_MAX_TIME           (0xFFFFFFFF) /* Max time value */
+#define HAL_XTASK_LAT_BUCKETS        (16)         /* Scheduling latency histogram buckets (log2 of milliseconds) */
+#define HAL_XTASK_MAX_PATH           (260)        /* Maximum bytes allowed for a statistics export file path */
+#define HAL_XTASK_SHARED_STACK_SIZE  (0x40000)    /* Execution stack shared by the tasks created with xTaskCreateShared() */
+#define HAL_XTASK_SHARED_MARGIN      (64)         /* Bytes below the stack pointer saved along with a shared stack task */
+#define HAL_XTASK_YIELD_ELISION      (1)          /* taskYIELD() returns at once when no other task is ready */
+#define HAL_XTASK_TIME_SLICE_US      (250)        /* Default time slice of xTaskYieldIfExpired() in microseconds */
+#define HAL_XTASK_PREEMPTION         (1)          /* Quantum based preemption at preemption points, see vTaskSetPreemption() */
+#define HAL_XTASK_WATCHDOG           (1)          /* Runaway task detection, see vTaskSetWatchdog() */
+#define HAL_XTASK_BACKTRACE_DEPTH    (16)         /* Return addresses captured for a runaway task */
+#define HAL_XTASK_PROFILER           (1)          /* Sampling profiler, see vTaskSetProfiler() */
+#define HAL_XTASK_PROF_DEPTH         (8)          /* Innermost return addresses recorded by a profiler sample */
+#define HAL_XTASK_PROF_SAMPLES       (4096)       /* Profiler samples kept, the oldest are overwritten */
+#define HAL_XTASK_FUTURE_STACK_SIZE  (0x4000)     /* Stack size of the child tasks started by xTaskSpawnFuture() */
+#define HAL_XFUTURE_INVALID_HANDLE   (0xFFFFFFFF) /* Invalid future handle value */
+#define HAL_XGROUP_INVALID_HANDLE    (0xFFFFFFFF) /* Invalid task group handle value */
+#define HAL_XTASK_ARENA_BLOCK_SIZE   (0x1000)     /* Bytes a task arena grows by, see xTaskArenaAlloc() */
+#define HAL_XTASK_ARENA_ALIGN        (8)          /* Alignment of the task arena allocations, a power of 2 */
+#define HAL_XTASK_MAILBOX_SIZE       (8)          /* Values a task mailbox holds, at most 255, see xTaskMailboxSend() */
+#define HAL_XTASK_STATIC_CTX_SIZE    (0x180 + 2 * sizeof(jmp_buf)) /* Bytes reserved for a task context by XTASK_STATIC_TABLE() */
 
 /* Force stack protection in debug builds */
 #ifdef _DEBUG
@@ -63,9 +87,147 @@ typedef void (*TaskFunction_t)(void *);
 
 typedef uint32_t TaskHandle_t; /*!< Task handle handle */
 
+typedef uint32_t SchedulerHandle_t; /*!< Scheduler instance handle */
+
+/* Blocking call offloaded to a worker thread, see xTaskRunBlocking() */
+typedef void *(*BlockingFunction_t)(void *arg);
+
+typedef uint32_t FutureHandle_t; /*!< Future handle, see xTaskSpawnFuture() */
+
+typedef uint32_t TaskGroupHandle_t; /*!< Task group handle, see xTaskGroupCreate() */
+
+/* Call run by a child task, its result is handed back by xFutureAwait() */
+typedef void *(*FutureFunction_t)(void *arg);
+
 /* 'Printf' style function definition */
 typedef int (*PrintfFn)(const char *__format, ...);
 
+/* Stackless task resume point, managed by the stackless.h macros */
+typedef struct
+{
+    uint32_t lc; /*!< Local continuation, 0 before the first turn */
+
+} XTask_PtTypeDef;
+
+/* Stackless task turn outcome */
+typedef enum
+{
+    XTaskPt_Waiting, /*!< Blocked, resume on a later turn */
+    XTaskPt_Ended,   /*!< Done, release the task */
+
+} XTask_PtState;
+
+/* Stackless task prototype, invoked on each turn until it returns XTaskPt_Ended */
+typedef XTask_PtState (*StacklessFunction_t)(XTask_PtTypeDef *pt, void *);
+
+/* Watchdog report of a task which ran longer than its budget without switching out */
+typedef struct
+{
+    TaskHandle_t handle;                               /*!< Offending task */
+    const char * name;                                 /*!< Task name */
+    uint32_t     duration;                             /*!< Ticks the task ran without switching out */
+    uint32_t     budget;                               /*!< Run budget it exceeded, in ticks */
+    int          stack_usage;                          /*!< Stack usage percentage, see xTaskGetStackUsage() */
+    uint32_t     depth;                                /*!< Count of addresses in 'backtrace', 0 when not captured */
+    uint32_t     backtrace[HAL_XTASK_BACKTRACE_DEPTH]; /*!< Code addresses the task was caught running, innermost first */
+
+} XTask_WatchdogReport;
+
+/* Stack of a task, see xTaskGetStacks() */
+typedef struct
+{
+    TaskHandle_t handle; /*!< Task */
+    const char * name;   /*!< Task name */
+    uint32_t     bottom; /*!< Lowest stack address */
+    uint32_t     top;    /*!< Stack top, the stack grows down from it */
+    uint32_t     sp;     /*!< Stack pointer the task is parked with, 0 when running or not started */
+    uint32_t     fp;     /*!< Frame pointer the task is parked with */
+    uint32_t     pc;     /*!< Code address the task resumes at */
+    uint8_t      shared; /*!< Runs on the shared stack, its stack is saved elsewhere while another task uses it */
+
+} XTask_StackInfo;
+
+/* Watchdog report call back, invoked from the scheduler loop */
+typedef void (*WatchdogFunction_t)(const XTask_WatchdogReport *report);
+
+/* Storage of a task context reserved at compile time, see XTASK_STATIC_TABLE() */
+typedef struct
+{
+    uint64_t storage[HAL_XTASK_STATIC_CTX_SIZE / sizeof(uint64_t)];
+
+} XTask_StaticCtxTypeDef;
+
+/* Storage of the scheduling state of a task reserved at compile time */
+typedef struct
+{
+    uint32_t storage[4];
+
+} XTask_StaticHotTypeDef;
+
+/* Task of a static task table */
+typedef struct
+{
+    const char *            name;      /*!< Task name */
+    TaskFunction_t          cb;        /*!< Task entry point */
+    void *                  args;      /*!< Task argument */
+    uint32_t                stackSize; /*!< Stack size in bytes */
+    XTask_StaticCtxTypeDef *ctx;       /*!< Context storage */
+    char *                  stack;     /*!< Stack storage, zero filled */
+
+} XTask_StaticTypeDef;
+
+/* Static task table, defined by XTASK_STATIC_TABLE() */
+typedef struct
+{
+    const XTask_StaticTypeDef *entries; /*!< Tasks, in their scheduling order */
+    XTask_StaticHotTypeDef *   hot;     /*!< Scheduling state storage, one per task */
+    void **                    tasks;   /*!< Task slots storage, one per task */
+    uint32_t                   count;   /*!< Count of tasks */
+
+} XTask_StaticTableTypeDef;
+
+/* Reserves the context and the stack of a static task, the stack has the same margin as xTaskCreate() */
+#define XTASK_STATIC_STORAGE_(id, name, cb, stackSize, ptr) \
+    static XTask_StaticCtxTypeDef xtask_ctx_##id;           \
+    static uint64_t               xtask_stack_##id[((stackSize) + 1024 + 7) / sizeof(uint64_t)];
+
+#define XTASK_STATIC_ENTRY_(id, name, cb, stackSize, ptr) {name, cb, ptr, stackSize, &xtask_ctx_##id, (char *) xtask_stack_##id},
+
+/* Defines a table of tasks whose contexts, stacks and scheduler slots are all reserved in .bss.
+ * 'TASKS' is a X macro listing the tasks in their scheduling order, each as X(id, name, cb, stackSize, ptr):
+ *
+ *   #define APP_TASKS(X) X(blink, "Blink", tsk_blink, 0x800, NULL) X(uart, "Uart", tsk_uart, 0x1000, NULL)
+ *   XTASK_STATIC_TABLE(gAppTasks, APP_TASKS);
+ */
+#define XTASK_STATIC_TABLE(table, TASKS)                                                                  \
+    TASKS(XTASK_STATIC_STORAGE_)                                                                          \
+    static const XTask_StaticTypeDef table##_entries[] = {TASKS(XTASK_STATIC_ENTRY_)};                    \
+    static XTask_StaticHotTypeDef    table##_hot[sizeof(table##_entries) / sizeof(table##_entries[0])];   \
+    static void *                    table##_tasks[sizeof(table##_entries) / sizeof(table##_entries[0])]; \
+    static const XTask_StaticTableTypeDef table = {table##_entries, table##_hot, table##_tasks, sizeof(table##_entries) / sizeof(table##_entries[0])}
+
+/* Handle of a task of a static table, a link time constant */
+#define XTASK_STATIC_HANDLE(id) ((TaskHandle_t) &xtask_ctx_##id)
+
+/* Machine readable statistics formats */
+typedef enum
+{
+    XTaskExport_JSON,       /*!< Single JSON document, one object per task */
+    XTaskExport_CSV,        /*!< Header line followed by one line per task */
+    XTaskExport_Prometheus, /*!< Prometheus text exposition format */
+
+} XTask_ExportFormat;
+
+/* How xTaskNotifyValue() updates the notification value of a task */
+typedef enum
+{
+    XTaskNotify_SetBits,    /*!< OR the bits into the value */
+    XTaskNotify_Increment,  /*!< Add one to the value, the value passed is ignored */
+    XTaskNotify_Overwrite,  /*!< Replace the value, even one not taken yet */
+    XTaskNotify_SetIfEmpty, /*!< Replace the value only when the previous one was taken */
+
+} XTask_NotifyAction;
+
 /**
  * @}
  */
@@ -78,16 +240,64 @@ typedef int (*PrintfFn)(const char *__format, ...);
 // clang-format off
 
 bool         vTaskStartScheduler(void  );
+void         vTaskEndScheduler(void);
 TaskHandle_t xTaskGetHandle(void);
 TaskHandle_t xTaskCreate(char *name, TaskFunction_t cb, uint32_t stackSize, void *ptr);
+TaskHandle_t xTaskCreateStackless(StacklessFunction_t cb, void *ptr);
+TaskHandle_t xTaskCreateShared(char *name, TaskFunction_t cb, void *ptr);
+bool         xTaskCreateStatic(const XTask_StaticTableTypeDef *table);
 int          xTaskGetStackUsage(TaskHandle_t handle);
 void         xTaskDumpStats(PrintfFn print);
+void         xTaskDumpContexts(PrintfFn print);
+uint32_t     xTaskGetStacks(XTask_StackInfo *info, uint32_t max);
+int          xTaskExportStats(XTask_ExportFormat format, char *buf, size_t size);
+bool         xTaskExportStatsToFile(XTask_ExportFormat format, const char *path);
+bool         vTaskSetStatsExport(XTask_ExportFormat format, const char *path, uint32_t interval);
 
 /* Signaling and execution control API */
 void         xTaskNotify(TaskHandle_t handle, uint32_t event);
 uint32_t     xTaskNotifyWait(uint32_t ticksToWait);
+bool         xTaskPtNotifyWait(uint32_t ticksToWait, uint32_t *events);
+bool         xTaskNotifyValue(TaskHandle_t handle, uint32_t value, XTask_NotifyAction action);
+bool         xTaskNotifyWaitValue(uint32_t ticksToWait, uint32_t *value);
+bool         xTaskMailboxSend(TaskHandle_t handle, uint64_t value);
+bool         xTaskMailboxReceive(uint32_t ticksToWait, uint64_t *value);
 void         taskYIELD(void);
+bool         xTaskYieldIfExpired(void);
+void         vTaskSetTimeSlice(uint32_t us);
+bool         vTaskSetPreemption(uint32_t quantum);
+bool         xTaskPreemptionPoint(void);
+bool         vTaskSetWatchdog(uint32_t budget, WatchdogFunction_t cb, bool backtrace);
+bool         vTaskSetBudget(TaskHandle_t handle, uint32_t budget);
+bool         vTaskSetProfiler(uint32_t period);
+void         vTaskResetProfile(void);
+bool         xTaskExportProfile(const char *path);
 void         vTaskDelay(uint32_t delay);
+uint32_t     vTaskDelayUntil(uint32_t *lastWake, uint32_t period);
+void *       xTaskRunBlocking(BlockingFunction_t fn, void *arg);
+void *       xTaskArenaAlloc(uint32_t size);
+void         xTaskArenaReset(void);
+
+/* Futures API, fork / join of child tasks */
+FutureHandle_t xTaskSpawnFuture(FutureFunction_t fn, void *arg);
+bool           xFutureAwait(FutureHandle_t future, uint32_t timeout, void **result);
+bool           xFutureIsDone(FutureHandle_t future);
+void           vFutureRelease(FutureHandle_t future);
+
+/* Task groups API, joins several tasks at once */
+TaskGroupHandle_t xTaskGroupCreate(void);
+bool              xTaskGroupAdd(TaskGroupHandle_t group, TaskHandle_t handle);
+bool              xTaskGroupWaitAll(TaskGroupHandle_t group, uint32_t timeout);
+void              vTaskGroupDelete(TaskGroupHandle_t group);
+
+/* Scheduler instances API, one instance per thread */
+SchedulerHandle_t xSchedulerCreate(void);
+SchedulerHandle_t xSchedulerSelect(SchedulerHandle_t handle);
+SchedulerHandle_t xSchedulerGetCurrent(void);
+bool              vSchedulerRun(SchedulerHandle_t handle);
+bool              vSchedulerDelete(SchedulerHandle_t handle);
+TaskHandle_t      xTaskCreateOn(SchedulerHandle_t sched, char *name, TaskFunction_t cb, uint32_t stackSize, void *ptr);
+void **           xSchedulerGetTimers(void);
 
 // clang-format on
 
@@ -99,6 +309,10 @@ void         vTaskDelay(uint32_t delay);
  * @}
  */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* LV662_HAL_XTSK_ */
 
 /************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,113 @@
+/**
+ ******************************************************************************
+ * @file    stackless.h
+ * @brief
+ *
+ *  Stackless (protothread style) tasks.
+ *  A stackless task is a plain function invoked by the scheduler on each of its
+ *  turns. It runs on the scheduler stack and blocks by returning, the macros below
+ *  record where it stopped and jump back to that point on the next turn. The task
+ *  context is a few tens of bytes, so millions of them can live alongside the
+ *  regular stackful tasks and use the same notify and delay API.
+ *
+ *  Restrictions, due to the lack of a stack of its own:
+ *   - Local variables do not survive a blocking macro, keep the state in 'args'
+ *     or in statics.
+ *   - Blocking macros may only be used in the task function itself, not in
+ *     functions it calls, and not inside a 'switch' statement.
+ *
+ *  Example:
+ *
+ *      XTask_PtState blinker(XTask_PtTypeDef *pt, void *args)
+ *      {
+ *          XPT_BEGIN(pt);
+ *          while ( 1 )
+ *          {
+ *              printf("tick\r\n");
+ *              XPT_DELAY(pt, 500);
+ *          }
+ *          XPT_END(pt);
+ *      }
+ *
+ *      xTaskCreateStackless(blinker, NULL);
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XPT_
+#define LV662_HAL_XPT_
+
+#include "scheduler.h"
+
+/** @addtogroup XTasks
+ * @{
+ */
+
+/* Exported macros -----------------------------------------------------------*/
+/** @defgroup XPT_Exported_Macros Stackless Tasks Exported Macros
+ * @{
+ */
+
+// clang-format off
+
+/* Resume points are numbered with __COUNTER__ rather than __LINE__ which is not
+ * a constant expression when MSVC builds with Edit and Continue (/ZI).
+ * The counter is expanded once and passed along so both uses see the same value.
+ */
+#define XPT_LC_SET(pt, n)                   (pt)->lc = (n); case (n):
+
+/* Opens the task body, must come first */
+#define XPT_BEGIN(pt)                       switch ( (pt)->lc ) { case 0:
+
+/* Closes the task body, the task ends when it gets here */
+#define XPT_END(pt)                         } (pt)->lc = 0; return XTaskPt_Ended
+
+/* Ends the task */
+#define XPT_EXIT(pt)                        do { (pt)->lc = 0; return XTaskPt_Ended; } while ( 0 )
+
+/* Lets the other tasks run */
+#define XPT_YIELD(pt)                       XPT_YIELD_(pt, __COUNTER__ + 1)
+#define XPT_YIELD_(pt, n)                   do { (pt)->lc = (n); taskYIELD(); return XTaskPt_Waiting; case (n):; } while ( 0 )
+
+/* Blocks for 'ticks' */
+#define XPT_DELAY(pt, ticks)                XPT_DELAY_(pt, ticks, __COUNTER__ + 1)
+#define XPT_DELAY_(pt, ticks, n)            do { (pt)->lc = (n); vTaskDelay(ticks); return XTaskPt_Waiting; case (n):; } while ( 0 )
+
+/* Blocks until an absolute deadline, see vTaskDelayUntil() */
+#define XPT_DELAY_UNTIL(pt, last, period)   XPT_DELAY_UNTIL_(pt, last, period, __COUNTER__ + 1)
+#define XPT_DELAY_UNTIL_(pt, last, period, n) \
+                                            do { (pt)->lc = (n); vTaskDelayUntil((last), (period)); return XTaskPt_Waiting; case (n):; } while ( 0 )
+
+/* Blocks until notified or 'ticks' expire, 'events' receives the event bits (0 when expired) */
+#define XPT_WAIT_NOTIFY(pt, ticks, events)  XPT_WAIT_NOTIFY_(pt, ticks, events, __COUNTER__ + 1)
+#define XPT_WAIT_NOTIFY_(pt, ticks, events, n) \
+                                            do { XPT_LC_SET(pt, n) if ( xTaskPtNotifyWait((ticks), &(events)) == false ) return XTaskPt_Waiting; } while ( 0 )
+
+/* Polls a condition once per scheduler pass until it holds */
+#define XPT_WAIT_UNTIL(pt, cond)            XPT_WAIT_UNTIL_(pt, cond, __COUNTER__ + 1)
+#define XPT_WAIT_UNTIL_(pt, cond, n)        do { XPT_LC_SET(pt, n) if ( ! (cond) ) { taskYIELD(); return XTaskPt_Waiting; } } while ( 0 )
+
+// clang-format on
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* LV662_HAL_XPT_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file    timers.h
+ * @brief
+ *
+ *  Software timers.
+ *  A timer invokes a call back once its period expires, either once or periodically.
+ *  Call backs are executed directly by the scheduler loop, on the scheduler stack,
+ *  so a timer costs a few bytes rather than a task and its stack. A call back
+ *  must not block: it may signal tasks and start or stop timers, but yielding
+ *  or delaying from it has no effect.
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XTMR_
+#define LV662_HAL_XTMR_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup XTimers
+ * @{
+ */
+
+#define HAL_XTIMER_INVALID_HANDLE (0xFFFFFFFF) /* Invalid handle value */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup XTMR_Exported_Macros XTimers Exported Macros
+ * @{
+ */
+
+typedef uint32_t TimerHandle_t; /*!< Timer handle */
+
+/* Timer call back prototype, the caller can pass parameter through the void pointer */
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer, void *ptr);
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup XTMR_Exported_Functions XTimers Exported Functions
+ * @{
+ */
+
+// clang-format off
+
+TimerHandle_t xTimerCreate(const char *name, uint32_t period, bool autoReload, TimerCallbackFunction_t cb, void *ptr);
+bool          xTimerStart(TimerHandle_t handle);
+bool          xTimerStop(TimerHandle_t handle);
+bool          xTimerChangePeriod(TimerHandle_t handle, uint32_t period);
+bool          xTimerIsActive(TimerHandle_t handle);
+bool          xTimerDelete(TimerHandle_t handle);
+
+/* Scheduler interface */
+uint32_t      xTimerProcess(void);
+uint32_t      xTimerGetNextExpiry(void);
+void          vTimerDeleteAll(void);
+
+// clang-format on
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LV662_HAL_XTMR_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,104 @@
+/**
+ ******************************************************************************
+ * @file    workers.h
+ * @brief
+ *
+ *  Worker threads pool.
+ *  Calls which block the calling OS thread (file system, DNS, compression..) would
+ *  stall every task of the scheduler loop. xTaskRunBlocking() ships such a call to a
+ *  bounded pool of OS threads shared by all the scheduler instances and parks the
+ *  calling task meanwhile, the scheduler readies it again once the call returned.
+ *  This module only runs the calls, the scheduler owns the completion queues.
+ *  xParallelFor() spreads a data parallel loop over the same threads and its caller.
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XWRK_
+#define LV662_HAL_XWRK_
+
+#include "scheduler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup XWorkers
+ * @{
+ */
+
+#define HAL_XWORK_MAX_THREADS       (4)  /* Maximum count of worker threads, started as needed */
+#define HAL_XWORK_CHUNKS_PER_THREAD (16) /* Smallest chunks xParallelFor() splits a range into when no grain is given, per thread */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup XWRK_Exported_Macros XWorkers Exported Macros
+ * @{
+ */
+
+/* A call handed to the worker threads */
+typedef struct __XWork_ItemTypeDef
+{
+    BlockingFunction_t           fn;     /*!< Call to run on a worker thread */
+    void *                       arg;    /*!< Call argument */
+    void *                       result; /*!< Call result, set once completed */
+    void *                       owner;  /*!< Submitter data, not used by the pool */
+    struct __XWork_QueueTypeDef *done;   /*!< Queue the item is moved to once completed */
+    struct __XWork_ItemTypeDef * next;   /*!< Link next pointer */
+
+} XWork_ItemTypeDef;
+
+/* Call processing the sub range [from, to) of xParallelFor() */
+typedef void (*RangeFunction_t)(uint32_t from, uint32_t to, void *ctx);
+
+/* Completed calls, one queue per submitter */
+typedef struct __XWork_QueueTypeDef
+{
+    XWork_ItemTypeDef *volatile head;     /*!< Completed items, most recent first */
+    volatile LONG               inflight; /*!< Items submitted and not completed yet */
+
+} XWork_QueueTypeDef;
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup XWRK_Exported_Functions XWorkers Exported Functions
+ * @{
+ */
+
+// clang-format off
+
+bool               xWorkSubmit(XWork_ItemTypeDef *item, XWork_QueueTypeDef *done);
+bool               xWorkCancel(XWork_ItemTypeDef *item);
+XWork_ItemTypeDef *xWorkCollect(XWork_QueueTypeDef *done);
+void               xParallelFor(uint32_t begin, uint32_t end, uint32_t grain, RangeFunction_t fn, void *ctx);
+
+// clang-format on
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LV662_HAL_XWRK_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,273 @@
+/**
+ ******************************************************************************
+ * @file    xsched.hpp
+ * @brief
+ *
+ *  Policy configured C++ front-end of the scheduler.
+ *  xt::scheduler<Config> owns a scheduler instance (see xSchedulerCreate()) and
+ *  takes its options as compile time constants of 'Config' rather than run time
+ *  calls: the time slice, preemption quantum and watchdog budget are applied when
+ *  the instance starts, and the front-end calls of the features a configuration
+ *  disables do not compile. The tasks are the C scheduler tasks, so timers,
+ *  notifications, futures, statistics and the watchdog all apply to them.
+ *  Each configuration is its own type, several of them coexist in one binary.
+ *
+ *  Example:
+ *
+ *      struct appliance_config : xt::default_config
+ *      {
+ *          static constexpr uint32_t stack_size      = 0x3000;
+ *          static constexpr uint32_t watchdog_budget = 50;
+ *          static constexpr bool     collect_stats   = false;
+ *      };
+ *
+ *      using appliance = xt::scheduler<appliance_config>;
+ *
+ *      void tsk_blink(void *args)
+ *      {
+ *          while ( 1 )
+ *              appliance::delay(500);
+ *      }
+ *
+ *      appliance sched;
+ *
+ *      sched.create("Blink", tsk_blink, NULL);
+ *      sched.start();
+ *
+ *  The compile time options of the library itself (HAL_XTASK_COLLECT_STATS,
+ *  HAL_XTASK_PREEMPTION, HAL_XTASK_WATCHDOG..) bound what a configuration may
+ *  enable, this is checked at compile time.
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XSCHED_HPP_
+#define LV662_HAL_XSCHED_HPP_
+
+#include "scheduler.h"
+#include "timers.h"
+
+#include <cstdint>
+
+namespace xt
+{
+
+/**
+ * @brief Default configuration, derive from it and override the options to change.
+ */
+
+struct default_config
+{
+    static constexpr uint32_t stack_size      = HAL_XTASK_DEFAULT_STACK_SIZE;  /* Stack size of the tasks created without one */
+    static constexpr bool     collect_stats   = (HAL_XTASK_COLLECT_STATS > 0); /* Statistics dump and export */
+    static constexpr bool     timers          = true;                          /* Software timers, see timers.h */
+    static constexpr uint32_t time_slice_us   = HAL_XTASK_TIME_SLICE_US;       /* Time slice of yield_if_expired() in microseconds */
+    static constexpr uint32_t preemption      = 0;                             /* Preemption quantum in milliseconds, 0 to disable */
+    static constexpr uint32_t watchdog_budget = 0;                             /* Watchdog run budget in ticks, 0 to disable */
+};
+
+/**
+ * @brief Scheduler instance, see default_config for the options.
+ */
+
+template <class Config = default_config>
+class scheduler
+{
+    static_assert(Config::stack_size > 0, "stack_size out of range");
+    static_assert(Config::time_slice_us > 0, "time_slice_us out of range");
+    static_assert(Config::collect_stats == false || HAL_XTASK_COLLECT_STATS > 0, "the library is built without statistics");
+    static_assert(Config::preemption == 0 || HAL_XTASK_PREEMPTION > 0, "the library is built without preemption");
+    static_assert(Config::watchdog_budget == 0 || HAL_XTASK_WATCHDOG > 0, "the library is built without the watchdog");
+
+    /* Selects the instance for the lifetime of the object, the tasks and timers created meanwhile are added to it */
+    class select
+    {
+      public:
+        explicit select(SchedulerHandle_t handle) : m_prev(xSchedulerSelect(handle)) {}
+        ~select()
+        {
+            if ( m_prev != HAL_XSCHED_INVALID_HANDLE )
+                xSchedulerSelect(m_prev);
+        }
+
+        bool valid() const { return m_prev != HAL_XSCHED_INVALID_HANDLE; }
+
+        select(const select &) = delete;
+        select &operator=(const select &) = delete;
+
+      private:
+        SchedulerHandle_t m_prev;
+    };
+
+  public:
+    scheduler() : m_handle(xSchedulerCreate()) {}
+
+    /* The instance and whatever it still holds are released, it must not be running */
+    ~scheduler()
+    {
+        if ( m_handle != HAL_XSCHED_INVALID_HANDLE )
+            vSchedulerDelete(m_handle);
+    }
+
+    scheduler(const scheduler &) = delete;
+    scheduler &operator=(const scheduler &) = delete;
+
+    /**
+     * @brief Checks whether the instance could be allocated.
+     * @retval Boolean.
+     */
+
+    bool valid() const { return m_handle != HAL_XSCHED_INVALID_HANDLE; }
+
+    /**
+     * @brief Gets the underlying instance, for the C API, see xSchedulerSelect().
+     * @retval Instance handle.
+     */
+
+    SchedulerHandle_t native_handle() const { return m_handle; }
+
+    /**
+     * @brief Creates a task in the instance, see xTaskCreate().
+     * @retval valid handle to the newly created task.
+     */
+
+    TaskHandle_t create(const char *name, TaskFunction_t cb, void *args, uint32_t stack_size = Config::stack_size)
+    {
+        return xTaskCreateOn(m_handle, const_cast<char *>(name), cb, stack_size, args);
+    }
+
+    /**
+     * @brief Creates a stackless task in the instance, see xTaskCreateStackless().
+     * @retval valid handle to the newly created task.
+     */
+
+    TaskHandle_t create_stackless(StacklessFunction_t cb, void *args)
+    {
+        select sel(m_handle);
+
+        return sel.valid() ? xTaskCreateStackless(cb, args) : HAL_XTASK_INVALID_HANDLE;
+    }
+
+    /**
+     * @brief Creates and starts a timer in the instance, see xTimerCreate(). The timer belongs
+     *        to the instance: its tasks and call backs use the timers.h calls, others invoke().
+     * @retval valid handle to the newly created timer.
+     */
+
+    TimerHandle_t start_timer(const char *name, uint32_t period, bool autoReload, TimerCallbackFunction_t cb, void *ptr)
+    {
+        static_assert(Config::timers, "timers are disabled by the configuration");
+
+        select        sel(m_handle);
+        TimerHandle_t handle = HAL_XTIMER_INVALID_HANDLE;
+
+        if ( sel.valid() )
+        {
+            handle = xTimerCreate(name, period, autoReload, cb, ptr);
+            xTimerStart(handle);
+        }
+
+        return handle;
+    }
+
+    /**
+     * @brief Calls 'fn' with the instance selected, for the C calls that work on the selected
+     *        instance. Must not be used while the instance is run by another thread.
+     * @retval What 'fn' returned.
+     */
+
+    template <class Fn>
+    auto invoke(Fn fn)
+    {
+        select sel(m_handle);
+
+        return fn();
+    }
+
+    /**
+     * @brief Applies the configuration and runs the instance in the calling thread until it
+     *        ends, see vSchedulerRun(). Cannot be called from within a task.
+     * @retval false when the instance was invalid, already running or had nothing to serve.
+     */
+
+    bool start()
+    {
+        {
+            select sel(m_handle);
+
+            if ( sel.valid() == false )
+                return false;
+
+            vTaskSetTimeSlice(Config::time_slice_us);
+
+            if constexpr ( Config::preemption > 0 )
+                vTaskSetPreemption(Config::preemption);
+
+            if constexpr ( Config::watchdog_budget > 0 )
+                vTaskSetWatchdog(Config::watchdog_budget, NULL, false);
+        }
+
+        return vSchedulerRun(m_handle);
+    }
+
+    /**
+     * @brief Dumps the tasks statistics of the instance, see xTaskDumpStats().
+     * @param print: 'printf' implementation
+     * @retval None.
+     */
+
+    void dump_stats(PrintfFn print)
+    {
+        static_assert(Config::collect_stats, "statistics are disabled by the configuration");
+
+        select sel(m_handle);
+
+        if ( sel.valid() )
+            xTaskDumpStats(print);
+    }
+
+    /**
+     * @brief Exports the tasks statistics of the instance, see xTaskExportStats().
+     * @retval Count of characters needed, -1 on error.
+     */
+
+    int export_stats(XTask_ExportFormat format, char *buf, size_t size)
+    {
+        static_assert(Config::collect_stats, "statistics are disabled by the configuration");
+
+        select sel(m_handle);
+
+        return sel.valid() ? xTaskExportStats(format, buf, size) : -1;
+    }
+
+    /* Calls made from within the tasks, they apply to the instance running the calling thread */
+
+    static void         end() { vTaskEndScheduler(); }
+    static void         yield() { taskYIELD(); }
+    static bool         yield_if_expired() { return xTaskYieldIfExpired(); }
+    static void         delay(uint32_t ticks) { vTaskDelay(ticks); }
+    static uint32_t     delay_until(uint32_t *lastWake, uint32_t period) { return vTaskDelayUntil(lastWake, period); }
+    static void         notify(TaskHandle_t handle, uint32_t events) { xTaskNotify(handle, events); }
+    static uint32_t     notify_wait(uint32_t timeout) { return xTaskNotifyWait(timeout); }
+    static TaskHandle_t current() { return xTaskGetHandle(); }
+
+  private:
+    SchedulerHandle_t m_handle; /* Scheduler instance */
+};
+
+} // namespace xt
+
+#endif /* LV662_HAL_XSCHED_HPP_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,323 @@
+/**
+ ******************************************************************************
+ * @file    xtask.hpp
+ * @brief
+ *
+ *  C++20 coroutine front-end.
+ *  A coroutine returning xt::task is driven by a stackless scheduler task (see
+ *  stackless.h): each of its turns resumes the coroutine, which runs on the
+ *  scheduler stack until its next co_await and returns. Coroutines are scheduled
+ *  by the same loop as the C tasks and cost their coroutine frame rather than
+ *  a task stack.
+ *
+ *  Example:
+ *
+ *      xt::queue<int> jobs;
+ *
+ *      xt::task consumer()
+ *      {
+ *          while ( true )
+ *          {
+ *              int job = co_await jobs.pop();
+ *              co_await xt::delay(std::chrono::milliseconds(job));
+ *          }
+ *      }
+ *
+ *      TaskHandle_t h = xt::spawn(consumer());
+ *
+ *  Awaiting is only possible from the coroutine passed to xt::spawn(), not from
+ *  the functions it calls. Coroutines still suspended when the scheduler ends
+ *  are not destroyed.
+ *
+ */
+
+/******************************************************************************
+ * @attention
+ *
+ * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+ * All rights reserved.</center></h2>
+ *
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef LV662_HAL_XTSK_HPP_
+#define LV662_HAL_XTSK_HPP_
+
+#include "scheduler.h"
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace xt
+{
+
+/* Notification bit used by xt::queue to wake a waiting coroutine */
+constexpr uint32_t QUEUE_EVENT = 0x80000000UL;
+
+/**
+ * @brief Coroutine task, hand it to xt::spawn() to have it scheduled.
+ */
+
+class task
+{
+  public:
+    struct promise_type
+    {
+        bool (*poll)(void *) = nullptr; /* Checks whether a resumed await is over, re-arms the wait when it is not */
+        void *   poll_arg    = nullptr; /* Poll argument, the pending awaiter */
+        uint32_t events      = 0;       /* Notification bits received while waiting on something else */
+
+        task                get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void                return_void() {}
+        void                unhandled_exception() { std::terminate(); }
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit task(handle_type h) : m_handle(h) {}
+    task(task &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    task &operator=(task &&)      = delete;
+
+    ~task()
+    {
+        if ( m_handle )
+            m_handle.destroy();
+    }
+
+    /* Releases the coroutine ownership */
+    handle_type release() { return std::exchange(m_handle, nullptr); }
+
+  private:
+    handle_type m_handle;
+};
+
+namespace detail
+{
+
+    /* The promise of the coroutine being resumed by the scheduler of the calling thread */
+    inline task::promise_type *&current()
+    {
+        static thread_local task::promise_type *promise = nullptr;
+        return promise;
+    }
+
+    /**
+     * @brief Stackless task function driving a coroutine.
+     */
+
+    inline XTask_PtState drive(XTask_PtTypeDef *pt, void *args)
+    {
+        auto  h       = task::handle_type::from_address(args);
+        auto &promise = h.promise();
+
+        /* Woken up although the awaited condition does not hold yet */
+        if ( promise.poll && promise.poll(promise.poll_arg) == false )
+            return XTaskPt_Waiting;
+
+        promise.poll = nullptr;
+        current()    = &promise;
+        h.resume();
+        current() = nullptr;
+
+        if ( h.done() )
+        {
+            h.destroy();
+            return XTaskPt_Ended;
+        }
+
+        return XTaskPt_Waiting;
+    }
+
+} // namespace detail
+
+/**
+ * @brief Schedules a coroutine, it is started on the next scheduler pass.
+ * @retval valid handle to the task running the coroutine, usable with xTaskNotify().
+ */
+
+inline TaskHandle_t spawn(task &&t)
+{
+    task::handle_type h      = t.release();
+    TaskHandle_t      handle = xTaskCreateStackless(detail::drive, h.address());
+
+    if ( handle == HAL_XTASK_INVALID_HANDLE )
+        h.destroy();
+
+    return handle;
+}
+
+/**
+ * @brief Suspends the coroutine for a duration, see vTaskDelay().
+ */
+
+struct delay
+{
+    uint32_t ticks;
+
+    template <class Rep, class Period>
+    explicit delay(std::chrono::duration<Rep, Period> d) : ticks((uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(d).count())
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<>) const noexcept { vTaskDelay(ticks); }
+    void await_resume() const noexcept {}
+};
+
+/**
+ * @brief Suspends the coroutine until notified or the timeout expires, see xTaskNotifyWait().
+ *        co_await yields the event bits, 0 when the wait expired.
+ */
+
+struct notified
+{
+    uint32_t ticks;
+    uint32_t events = 0;
+
+    explicit notified(uint32_t timeout = HAL_XTASK_MAX_TIME) : ticks(timeout) {}
+
+    template <class Rep, class Period>
+    explicit notified(std::chrono::duration<Rep, Period> d) : ticks((uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(d).count())
+    {
+    }
+
+    /* Bits set aside by a queue wait are delivered first */
+    bool await_ready() noexcept
+    {
+        task::promise_type *promise = detail::current();
+
+        events = promise ? std::exchange(promise->events, 0) : 0;
+        return events != 0;
+    }
+
+    /* Returning false resumes right away, the events were already there */
+    bool await_suspend(std::coroutine_handle<>) noexcept { return xTaskPtNotifyWait(ticks, &events) == false; }
+
+    uint32_t await_resume() noexcept
+    {
+        if ( events == 0 )
+            xTaskPtNotifyWait(ticks, &events);
+
+        return events;
+    }
+};
+
+/**
+ * @brief Single threaded FIFO whose pop() suspends the coroutine while it is empty.
+ *        Items pushed while coroutines are waiting are handed straight to the first of them.
+ */
+
+template <class T>
+class queue
+{
+  public:
+    class pop_awaiter
+    {
+      public:
+        explicit pop_awaiter(queue &q) : m_queue(q) {}
+
+        bool await_ready() noexcept
+        {
+            if ( m_queue.m_items.empty() )
+                return false;
+
+            m_item.emplace(std::move(m_queue.m_items.front()));
+            m_queue.m_items.pop_front();
+            return true;
+        }
+
+        void await_suspend(std::coroutine_handle<task::promise_type> h)
+        {
+            m_handle  = xTaskGetHandle();
+            m_promise = &h.promise();
+            m_queue.m_waiters.push_back(this);
+
+            m_promise->poll     = &pop_awaiter::poll;
+            m_promise->poll_arg = this;
+
+            wait();
+        }
+
+        T await_resume() { return std::move(*m_item); }
+
+      private:
+        friend class queue;
+
+        /* Blocks the task on a notification, other notification bits are kept for a later xt::notified */
+        void wait()
+        {
+            uint32_t events;
+
+            /* Bits already pending complete the wait at once, set them aside and arm it again */
+            if ( xTaskPtNotifyWait(HAL_XTASK_MAX_TIME, &events) == true )
+            {
+                m_promise->events |= (events & ~QUEUE_EVENT);
+                xTaskPtNotifyWait(HAL_XTASK_MAX_TIME, &events);
+            }
+        }
+
+        /* Resumed, checks whether an item was handed over */
+        static bool poll(void *arg)
+        {
+            pop_awaiter *self = static_cast<pop_awaiter *>(arg);
+            uint32_t     events;
+
+            xTaskPtNotifyWait(HAL_XTASK_MAX_TIME, &events);
+            self->m_promise->events |= (events & ~QUEUE_EVENT);
+
+            if ( self->m_item.has_value() )
+                return true;
+
+            /* Woken up by other bits, wait again */
+            self->wait();
+            return false;
+        }
+
+        queue &             m_queue;
+        std::optional<T>    m_item;
+        TaskHandle_t        m_handle  = HAL_XTASK_INVALID_HANDLE;
+        task::promise_type *m_promise = nullptr;
+    };
+
+    void push(T item)
+    {
+        pop_awaiter *waiter;
+
+        if ( m_waiters.empty() )
+        {
+            m_items.push_back(std::move(item));
+            return;
+        }
+
+        waiter = m_waiters.front();
+        m_waiters.pop_front();
+        waiter->m_item.emplace(std::move(item));
+        xTaskNotify(waiter->m_handle, QUEUE_EVENT);
+    }
+
+    pop_awaiter pop() { return pop_awaiter(*this); }
+
+    bool   empty() const { return m_items.empty(); }
+    size_t size() const { return m_items.size(); }
+
+  private:
+    std::deque<T>             m_items;
+    std::deque<pop_awaiter *> m_waiters;
+};
+
+} // namespace xt
+
+#endif /* LV662_HAL_XTSK_HPP_ */
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,741 @@
+/**
+  ******************************************************************************
+  * @file    logger.c
+  * @brief   Asynchronous console logger module driver.
+  *
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+  * All rights reserved.</center></h2>
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include "logger.h"
+#include "ansi.h"
+
+/**
+  * @brief A logged line, 128 bytes with the default message size.
+  */
+
+typedef struct __XLog_RecordTypeDef
+{
+    volatile LONG seq;                     /* Ring position the record is free for, or position + 1 once written */
+    uint32_t      tick;                    /* Tick value the line was logged at */
+    uint32_t      color;                   /* Line color, HAL_TermColor */
+    char          text[HAL_XLOG_MSG_SIZE]; /* Formatted message */
+
+} XLog_RecordTypeDef;
+
+/**
+  * @brief Deferred records of a thread, single producer single consumer ring.
+  */
+
+typedef struct __XLog_BufferTypeDef
+{
+    volatile LONG                head;                    /* Next offset written by the thread */
+    volatile LONG                tail;                    /* Next offset read by the logger thread */
+    volatile LONG                orphan;                  /* Set once the thread exited, released when drained */
+    struct __XLog_BufferTypeDef *next;                    /* Link next pointer */
+    uint8_t                      data[HAL_XLOG_BIN_SIZE]; /* Records */
+
+} XLog_BufferTypeDef;
+
+/* Format id of the call sites which cannot be deferred, logged as text instead */
+#define XLOG_ID_TEXT (0x7FFFFFFF)
+
+/**
+  * @brief Module locals.
+  */
+
+typedef struct __XLog_ConfigTypeDef
+{
+    XLog_RecordTypeDef records[HAL_XLOG_RECORDS];   /* Ring buffer */
+    volatile LONG      head;                        /* Next position claimed by a producer */
+    volatile LONG      tail;                        /* Next position read by the logger thread */
+    volatile LONG      passes;                      /* Count of logger thread passes */
+    volatile LONG      dropped;                     /* Lines dropped due to the ring being full */
+    LONG               reported;                    /* Dropped lines already reported */
+    HANDLE             wake;                        /* Wakes the logger thread before its period ends */
+    HANDLE             thread;                      /* Logger thread, NULL when it could not be started */
+    volatile LONG      init;                        /* 0: not initialized, 1: being initialized, 2: ready */
+    char               batch[HAL_XLOG_BATCH_SIZE];  /* Lines written to the console at once */
+    CRITICAL_SECTION   lock;                        /* Guards the deferred records buffers list and the log file */
+    XLog_BufferTypeDef *buffers;                    /* Deferred records buffers, one per thread */
+    DWORD              fls;                         /* Fiber local storage index telling a buffer its thread exited */
+    XLog_FormatTypeDef *formats[HAL_XLOG_MAX_FORMATS]; /* Deferred call sites, by id */
+    volatile LONG      format_count;                /* Last id handed out */
+    FILE *             file;                        /* Binary log file, NULL to format the deferred records */
+    uint32_t           tick;                        /* Tick value at initialization */
+    uint64_t           cycles;                      /* Cycle counter value at initialization */
+    uint64_t           freq;                        /* Cycle counter frequency */
+
+} XLog_ConfigTypeDef;
+
+/* Container for this module globals, shared by all the threads */
+XLog_ConfigTypeDef gXLog = {.head = 0, .tail = 0, .passes = 0, .dropped = 0, .init = 0};
+
+/* Deferred records buffer of the calling thread */
+static __declspec(thread) XLog_BufferTypeDef *gXLogBuffer = NULL;
+
+/* Escape sequences of the HAL_TermColor values */
+static const char *const gXLogColors[] = {ANSI_MODE, ANSI_RED, ANSI_GREEN, ANSI_BLUE, ANSI_YELLOW};
+#define HAL_XLOG_COLORS (sizeof(gXLogColors) / sizeof(gXLogColors[0]))
+
+/**
+  * @brief Stamps a deferred record: the tick value under virtual time, the cycle counter otherwise.
+  * @retval Record stamp.
+  */
+
+static uint64_t xLogStamp(void)
+{
+    if ( HAL_IsVirtualTime() )
+        return HAL_GetTick();
+
+    return HAL_GetCycles();
+}
+
+/**
+  * @brief Converts a deferred record stamp to a tick value.
+  * @retval Tick value.
+  */
+
+static uint32_t xLogStampToTick(uint64_t stamp)
+{
+    if ( HAL_IsVirtualTime() )
+        return (uint32_t) stamp;
+
+    return gXLog.tick + (uint32_t) ((stamp - gXLog.cycles) * 1000 / gXLog.freq);
+}
+
+/**
+  * @brief Appends a line to the batch.
+  * @retval Count of bytes appended.
+  */
+
+static int xLogFormat(char *buf, size_t size, uint32_t tick, uint32_t color, const char *text)
+{
+    HAL_TimeTypeDef timestamp = {0};
+    int             len;
+
+    if ( tick )
+        HAL_TicksToTime(&timestamp, tick);
+
+    len = snprintf(buf, size, "[%02d.%02d:%02d:%02d.%03d] %s%s\r\n" ANSI_MODE, timestamp.days, timestamp.hours, timestamp.minutes,
+                   timestamp.seconds, (int) timestamp.msecs, gXLogColors[color < HAL_XLOG_COLORS ? color : Color_White], text);
+
+    return HAL_MIN(HAL_MAX(len, 0), (int) size - 1);
+}
+
+/**
+  * @brief Writes the definition of a format to the binary log file, before its first record.
+  * @retval None.
+  */
+
+static void vLogWriteFormat(XLog_FormatTypeDef *format)
+{
+    XLog_FormatHeaderTypeDef hdr;
+    uint32_t                 len     = (uint32_t) strlen(format->format) + 1;
+    static const uint8_t     pad[4]  = {0};
+
+    hdr.id        = XLOG_ID_FORMAT;
+    hdr.size      = (uint16_t) ((sizeof(hdr) + len + 3) & ~3);
+    hdr.format_id = (uint16_t) format->id;
+    hdr.color     = (uint16_t) format->color;
+
+    fwrite(&hdr, 1, sizeof(hdr), gXLog.file);
+    fwrite(format->format, 1, len, gXLog.file);
+    fwrite(pad, 1, hdr.size - sizeof(hdr) - len, gXLog.file);
+
+    format->written = true;
+}
+
+/**
+  * @brief Formats the deferred records of a thread into the batch, or writes them to the log file.
+  * @retval Count of bytes in the batch.
+  */
+
+static int xLogDrainDeferred(XLog_BufferTypeDef *buffer, int len)
+{
+    XLog_RecordHeaderTypeDef *rec;
+    XLog_FormatTypeDef *      format;
+    LONG                      tail = buffer->tail;
+    LONG                      head = buffer->head;
+    uint64_t                  cycles;
+    char                      text[HAL_XLOG_MSG_SIZE * 2];
+
+    while ( tail != head )
+    {
+        rec = (XLog_RecordHeaderTypeDef *) &buffer->data[tail & (HAL_XLOG_BIN_SIZE - 1)];
+
+        /* Padding up to the ring end */
+        if ( rec->id == XLOG_ID_WRAP )
+        {
+            tail += HAL_XLOG_BIN_SIZE - (tail & (HAL_XLOG_BIN_SIZE - 1));
+            continue;
+        }
+
+        format = gXLog.formats[rec->id];
+
+        if ( gXLog.file )
+        {
+            if ( ! format->written )
+                vLogWriteFormat(format);
+
+            fwrite(rec, 1, rec->size, gXLog.file);
+        }
+        else
+        {
+            if ( len + (int) sizeof(text) + 64 > HAL_XLOG_BATCH_SIZE )
+            {
+                fwrite(gXLog.batch, 1, len, stdout);
+                len = 0;
+            }
+
+            cycles = ((uint64_t) rec->cycles_hi << 32) | rec->cycles_lo;
+            xLogFormatArgs(text, sizeof(text), format->format, (const uint8_t *) (rec + 1), rec->size - sizeof(XLog_RecordHeaderTypeDef));
+            len += xLogFormat(gXLog.batch + len, sizeof(gXLog.batch) - len, xLogStampToTick(cycles), format->color, text);
+        }
+
+        tail += rec->size;
+    }
+
+    /* Hand the space back to the thread */
+    InterlockedExchange(&buffer->tail, tail);
+
+    return len;
+}
+
+/**
+  * @brief Writes the records published so far to the console, releasing their slots.
+  * @retval None.
+  */
+
+static void vLogDrain(void)
+{
+    XLog_RecordTypeDef * rec;
+    XLog_BufferTypeDef * buffer;
+    XLog_BufferTypeDef **link;
+    LONG                 dropped, orphan;
+    int                  len = 0;
+
+    while ( 1 )
+    {
+        rec = &gXLog.records[gXLog.tail & (HAL_XLOG_RECORDS - 1)];
+
+        /* Claimed by a producer still formatting it, or nothing more */
+        if ( rec->seq != gXLog.tail + 1 )
+            break;
+
+        /* Room for the longest line */
+        if ( len + HAL_XLOG_MSG_SIZE + 64 > HAL_XLOG_BATCH_SIZE )
+        {
+            fwrite(gXLog.batch, 1, len, stdout);
+            len = 0;
+        }
+
+        len += xLogFormat(gXLog.batch + len, sizeof(gXLog.batch) - len, rec->tick, rec->color, rec->text);
+
+        /* Hand the slot back for the next lap */
+        InterlockedExchange(&rec->seq, gXLog.tail + HAL_XLOG_RECORDS);
+        gXLog.tail++;
+    }
+
+    EnterCriticalSection(&gXLog.lock);
+
+    for ( link = &gXLog.buffers; (buffer = *link) != NULL; )
+    {
+        /* Sampled first, an exited thread had published its last records by then */
+        orphan = buffer->orphan;
+        len    = xLogDrainDeferred(buffer, len);
+
+        if ( orphan && buffer->tail == buffer->head )
+        {
+            *link = buffer->next;
+            free(buffer);
+        }
+        else
+        {
+            link = &buffer->next;
+        }
+    }
+
+    if ( gXLog.file )
+        fflush(gXLog.file);
+
+    LeaveCriticalSection(&gXLog.lock);
+
+    dropped = gXLog.dropped;
+    if ( dropped != gXLog.reported )
+    {
+        len += snprintf(gXLog.batch + len, sizeof(gXLog.batch) - len, ANSI_RED "%ld log lines dropped\r\n" ANSI_MODE, dropped - gXLog.reported);
+        gXLog.reported = dropped;
+    }
+
+    if ( len > 0 )
+    {
+        fwrite(gXLog.batch, 1, len, stdout);
+        fflush(stdout);
+    }
+
+    InterlockedIncrement(&gXLog.passes);
+}
+
+/**
+  * @brief Logger thread, drains the ring periodically or once woken up.
+  * @retval Thread exit code.
+  */
+
+static DWORD WINAPI xLogThread(LPVOID param)
+{
+    while ( 1 )
+    {
+        WaitForSingleObject(gXLog.wake, HAL_XLOG_PERIOD);
+        vLogDrain();
+    }
+
+    return 0;
+}
+
+/**
+  * @brief Called as a thread exits with its deferred records buffer, the logger thread
+  *        releases the buffer once it wrote what is left in it.
+  * @retval None.
+  */
+
+static VOID WINAPI vLogThreadExit(PVOID data)
+{
+    if ( data )
+        InterlockedExchange(&((XLog_BufferTypeDef *) data)->orphan, 1);
+}
+
+/**
+  * @brief Initializes the module on first use, from whichever thread gets there first.
+  * @retval None.
+  */
+
+static void vLogInit(void)
+{
+    LONG i;
+
+    if ( gXLog.init == 2 )
+        return;
+
+    if ( InterlockedCompareExchange(&gXLog.init, 1, 0) == 0 )
+    {
+        for ( i = 0; i < HAL_XLOG_RECORDS; i++ )
+            gXLog.records[i].seq = i;
+
+        InitializeCriticalSection(&gXLog.lock);
+        gXLog.fls    = FlsAlloc(vLogThreadExit);
+        gXLog.tick   = HAL_GetTick();
+        gXLog.cycles = HAL_GetCycles();
+        gXLog.freq   = HAL_GetCycleFrequency();
+
+        gXLog.wake   = CreateEvent(NULL, FALSE, FALSE, NULL);
+        gXLog.thread = gXLog.wake ? CreateThread(NULL, 0, xLogThread, NULL, 0, NULL) : NULL;
+
+        /* Formatting is never urgent compared to the tasks */
+        if ( gXLog.thread )
+            SetThreadPriority(gXLog.thread, THREAD_PRIORITY_BELOW_NORMAL);
+
+        InterlockedExchange(&gXLog.init, 2);
+    }
+
+    /* Another thread is initializing the module */
+    while ( gXLog.init != 2 )
+        Sleep(0);
+}
+
+/**
+  * @brief Logs a line, see xLogPrint().
+  * @retval Count of bytes of the formatted message, -1 when the line was dropped.
+  */
+
+int xLogPrintV(HAL_TermColor color, const char *format, va_list list)
+{
+    XLog_RecordTypeDef *rec;
+    LONG                pos, seq;
+    int                 size;
+    char                line[HAL_XLOG_MSG_SIZE + 64];
+
+    if ( ! format )
+        return -1;
+
+    vLogInit();
+
+    /* No logger thread, write in place */
+    if ( gXLog.thread == NULL )
+    {
+        char text[HAL_XLOG_MSG_SIZE];
+
+        size = vsnprintf(text, sizeof(text), format, list);
+        fwrite(line, 1, xLogFormat(line, sizeof(line), HAL_GetTick(), color, text), stdout);
+        return size;
+    }
+
+    /* Claim a free record, the ring may be full */
+    pos = gXLog.head;
+    while ( 1 )
+    {
+        rec = &gXLog.records[pos & (HAL_XLOG_RECORDS - 1)];
+        seq = rec->seq;
+
+        if ( seq == pos )
+        {
+            if ( InterlockedCompareExchange(&gXLog.head, pos + 1, pos) == pos )
+                break;
+        }
+        else if ( (LONG) ((ULONG) seq - (ULONG) pos) < 0 )
+        {
+            InterlockedIncrement(&gXLog.dropped);
+            return -1;
+        }
+
+        pos = gXLog.head;
+    }
+
+    size = vsnprintf(rec->text, sizeof(rec->text), format, list);
+    if ( size < 0 )
+        rec->text[0] = 0;
+
+    rec->tick  = HAL_GetTick();
+    rec->color = (uint32_t) color;
+
+    /* Publish it */
+    InterlockedExchange(&rec->seq, pos + 1);
+
+    /* Filling up, do not wait for the period to end */
+    if ( pos + 1 - gXLog.tail >= HAL_XLOG_RECORDS / 2 )
+        SetEvent(gXLog.wake);
+
+    return size;
+}
+
+/**
+  * @brief Logs a timestamped and colored line, the message is formatted by the caller
+  *        and written to the console later on by the logger thread.
+  * @retval Count of bytes of the formatted message, -1 when the line was dropped.
+  */
+
+int xLogPrint(HAL_TermColor color, const char *format, ...)
+{
+    va_list list;
+    int     size;
+
+    va_start(list, format);
+    size = xLogPrintV(color, format, list);
+    va_end(list);
+
+    return size;
+}
+
+/**
+  * @brief Assigns an id to a deferred call site and works out how its arguments are encoded,
+  *        on the first call. Call sites the encoding does not support are logged as text.
+  * @retval None.
+  */
+
+static void vLogRegister(XLog_FormatTypeDef *format)
+{
+    XLog_SpecTypeDef spec;
+    const char *     p     = format->format;
+    uint32_t         count = 0, size = sizeof(XLog_RecordHeaderTypeDef);
+    LONG             id    = XLOG_ID_TEXT;
+    int              used;
+
+    /* Another thread is registering it */
+    if ( InterlockedCompareExchange(&format->id, -1, 0) != 0 )
+    {
+        while ( format->id == -1 )
+            Sleep(0);
+
+        return;
+    }
+
+    while ( p && *p )
+    {
+        if ( *p++ != '%' )
+            continue;
+
+        used = xLogParseSpec(p - 1, &spec);
+        if ( used == 0 || spec.type == XLogArg_Unsupported || count + spec.stars + 1 > XLOG_MAX_ARGS )
+            break;
+
+        p += used - 1;
+        if ( spec.type == XLogArg_None )
+            continue;
+
+        for ( ; spec.stars > 0; spec.stars-- )
+        {
+            format->types[count++] = XLogArg_Int;
+            size += 4;
+        }
+
+        format->types[count++] = (uint8_t) (spec.type | (spec.is_signed ? XLOG_ARG_SIGNED : 0));
+        size += (spec.type == XLogArg_Int) ? 4 : (spec.type == XLogArg_String) ? 2 + XLOG_MAX_STRING : 8;
+    }
+
+    /* The whole format was parsed */
+    if ( p && *p == 0 )
+    {
+        id = InterlockedIncrement(&gXLog.format_count);
+        if ( id < HAL_XLOG_MAX_FORMATS )
+            gXLog.formats[id] = format;
+        else
+            id = XLOG_ID_TEXT;
+    }
+
+    format->count    = (uint8_t) count;
+    format->max_size = (uint16_t) ((size + 3) & ~3);
+    InterlockedExchange(&format->id, id);
+}
+
+/**
+  * @brief Gets the deferred records buffer of the calling thread, created on its first use.
+  * @note  Without a fiber local storage index the buffers of exited threads are never released.
+  * @retval Buffer, NULL when out of memory.
+  */
+
+static XLog_BufferTypeDef *xLogGetBuffer(void)
+{
+    XLog_BufferTypeDef *buffer = gXLogBuffer;
+
+    if ( buffer )
+        return buffer;
+
+    buffer = malloc(sizeof(XLog_BufferTypeDef));
+    if ( buffer == NULL )
+        return NULL;
+
+    buffer->head   = 0;
+    buffer->tail   = 0;
+    buffer->orphan = 0;
+
+    /* Handed to vLogThreadExit() when this thread exits */
+    if ( gXLog.fls != FLS_OUT_OF_INDEXES )
+        FlsSetValue(gXLog.fls, buffer);
+
+    EnterCriticalSection(&gXLog.lock);
+    buffer->next  = gXLog.buffers;
+    gXLog.buffers = buffer;
+    LeaveCriticalSection(&gXLog.lock);
+
+    gXLogBuffer = buffer;
+    return buffer;
+}
+
+/**
+  * @brief Logs a line with a deferred formatting, see XLOG(). The caller only copies the
+  *        arguments into a buffer of its thread, the logger thread formats them later on.
+  *        String arguments are copied as well, up to XLOG_MAX_STRING characters.
+  * @retval None.
+  */
+
+void vLogDeferred(XLog_FormatTypeDef *format, ...)
+{
+    XLog_RecordHeaderTypeDef *rec;
+    XLog_BufferTypeDef *      buffer;
+    uint64_t                  cycles = xLogStamp();
+    va_list                   list;
+    LONG                      head, room;
+    uint8_t *                 arg;
+    const char *              str;
+    uint16_t                  len;
+    int32_t                   i32;
+    int64_t                   i64;
+    double                    dbl;
+    uint32_t                  i;
+
+    vLogInit();
+
+    if ( format->id <= 0 )
+        vLogRegister(format);
+
+    va_start(list, format);
+
+    if ( format->id == XLOG_ID_TEXT || gXLog.thread == NULL || (buffer = xLogGetBuffer()) == NULL )
+    {
+        xLogPrintV(format->color, format->format, list);
+        va_end(list);
+        return;
+    }
+
+    /* A record does not wrap around the ring end, the end is padded instead */
+    head = buffer->head;
+    room = HAL_XLOG_BIN_SIZE - (head & (HAL_XLOG_BIN_SIZE - 1));
+    if ( room < format->max_size )
+        head += room;
+
+    if ( head + format->max_size - buffer->tail > HAL_XLOG_BIN_SIZE )
+    {
+        InterlockedIncrement(&gXLog.dropped);
+        va_end(list);
+        return;
+    }
+
+    if ( head != buffer->head )
+        ((XLog_RecordHeaderTypeDef *) &buffer->data[buffer->head & (HAL_XLOG_BIN_SIZE - 1)])->id = XLOG_ID_WRAP;
+
+    rec = (XLog_RecordHeaderTypeDef *) &buffer->data[head & (HAL_XLOG_BIN_SIZE - 1)];
+    arg = (uint8_t *) (rec + 1);
+
+    for ( i = 0; i < format->count; i++ )
+    {
+        switch ( format->types[i] )
+        {
+            case XLogArg_Int:
+            case XLogArg_Int | XLOG_ARG_SIGNED:
+                i32 = va_arg(list, int);
+                memcpy(arg, &i32, 4);
+                arg += 4;
+                continue;
+
+            case XLogArg_Long:
+                i64 = (int64_t) va_arg(list, unsigned long);
+                break;
+
+            case XLogArg_Long | XLOG_ARG_SIGNED:
+                i64 = (int64_t) va_arg(list, long);
+                break;
+
+            case XLogArg_Size:
+                i64 = (int64_t) va_arg(list, size_t);
+                break;
+
+            case XLogArg_Size | XLOG_ARG_SIGNED:
+                i64 = (int64_t) va_arg(list, ptrdiff_t);
+                break;
+
+            case XLogArg_Double:
+                dbl = va_arg(list, double);
+                memcpy(arg, &dbl, 8);
+                arg += 8;
+                continue;
+
+            case XLogArg_Pointer:
+                i64 = (int64_t) (uintptr_t) va_arg(list, void *);
+                break;
+
+            case XLogArg_String:
+                str = va_arg(list, const char *);
+                str = str ? str : "(null)";
+                for ( len = 0; len < XLOG_MAX_STRING && str[len]; len++ )
+                    ;
+
+                memcpy(arg, &len, 2);
+                memcpy(arg + 2, str, len);
+                arg += 2 + len;
+                continue;
+
+            default:
+                i64 = va_arg(list, long long);
+                break;
+        }
+
+        memcpy(arg, &i64, 8);
+        arg += 8;
+    }
+
+    va_end(list);
+
+    rec->id        = (uint16_t) format->id;
+    rec->size      = (uint16_t) ((arg - (uint8_t *) rec + 3) & ~3);
+    rec->cycles_lo = (uint32_t) cycles;
+    rec->cycles_hi = (uint32_t) (cycles >> 32);
+
+    /* Publish it */
+    InterlockedExchange(&buffer->head, head + rec->size);
+
+    if ( buffer->head - buffer->tail >= HAL_XLOG_BIN_SIZE / 2 )
+        SetEvent(gXLog.wake);
+}
+
+/**
+  * @brief Directs the deferred records to a binary log file rather than to the console,
+  *        see the logdecode tool. Any previous file is closed.
+  * @param path: file to create, NULL to format the records on the console again.
+  * @retval false when the file could not be created.
+  */
+
+bool xLogSetBinaryFile(const char *path)
+{
+    XLog_FileHeaderTypeDef hdr;
+    FILE *                 file = NULL;
+    uint64_t               cycles, freq;
+    LONG                   i;
+
+    vLogInit();
+
+    if ( path )
+    {
+        file = fopen(path, "wb");
+        if ( file == NULL )
+            return false;
+
+        /* Under virtual time the records hold ticks, a 1000 Hz counter matching the tick value */
+        hdr.magic   = XLOG_FILE_MAGIC;
+        hdr.version = XLOG_FILE_VERSION;
+        hdr.tick    = HAL_GetTick();
+        cycles      = HAL_IsVirtualTime() ? hdr.tick : HAL_GetCycles();
+        freq        = HAL_IsVirtualTime() ? 1000 : gXLog.freq;
+
+        hdr.cycles_lo = (uint32_t) cycles;
+        hdr.cycles_hi = (uint32_t) (cycles >> 32);
+        hdr.freq_lo   = (uint32_t) freq;
+        hdr.freq_hi   = (uint32_t) (freq >> 32);
+        fwrite(&hdr, 1, sizeof(hdr), file);
+    }
+
+    EnterCriticalSection(&gXLog.lock);
+
+    if ( gXLog.file )
+        fclose(gXLog.file);
+
+    /* The new file needs the definitions again */
+    for ( i = 1; i <= gXLog.format_count && i < HAL_XLOG_MAX_FORMATS; i++ )
+        if ( gXLog.formats[i] )
+            gXLog.formats[i]->written = false;
+
+    gXLog.file = file;
+    LeaveCriticalSection(&gXLog.lock);
+
+    return true;
+}
+
+/**
+  * @brief Waits for the lines logged so far to reach the console, for instance before exiting.
+  * @retval None.
+  */
+
+void vLogFlush(void)
+{
+    LONG passes = gXLog.passes;
+
+    if ( gXLog.init != 2 || gXLog.thread == NULL )
+        return;
+
+    /* The pass in progress may have missed the latest lines, wait for the next one */
+    while ( gXLog.passes - passes < 2 )
+    {
+        SetEvent(gXLog.wake);
+        Sleep(1);
+    }
+}
+
+/**
+  * @brief Gets the count of lines dropped since the start because the ring was full.
+  * @retval Count of lines.
+  */
+
+uint32_t xLogGetDropped(void)
+{
+    return (uint32_t) gXLog.dropped;
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
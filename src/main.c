@@ -16,14 +16,25 @@
 
 #include "hal.h"
 #include "scheduler.h"
+#include "stackless.h"
+#include "timers.h"
 
 /* Global task handles */
-TaskHandle_t htsk_moshe, htsk_aviv, htsk_eli;
+TaskHandle_t htsk_moshe, htsk_aviv, htsk_eli, htsk_dana;
+
+/* Stackless task Dana state */
+uint32_t dana_count = 0;
+
+/* Coroutine tasks, see main_coro.cpp */
+void main_coro_create(void);
+
+/* Configured C++ scheduler instance, see main_xsched.cpp */
+void main_xsched_run(void);
 
 /**************************************************************************/ /**
  *                                                                           
  * @brief
- *  Task Moshe: Pause for 2 seconds and notifies task C.
+ *  Task Moshe: Runs every 2 seconds and mails a counter to task Eli.
  * @return
  *   nothing.
  *
@@ -31,17 +42,25 @@ TaskHandle_t htsk_moshe, htsk_aviv, htsk_eli;
 
 void tsk_moshe(void *args)
 {
-    int val = 0;
+    int      val      = 0;
+    uint32_t lastWake = HAL_GetTick();
+    uint32_t missed;
 
     while ( 1 )
     {
         printf_c(Color_Green, "Moshe Loop started..");
 
-        vTaskDelay(2000);
+        /* Hold a steady 2 seconds period no matter how long printing took */
+        missed = vTaskDelayUntil(&lastWake, 2000);
+        if ( missed > 0 )
+            printf_c(Color_Yellow, "Moshe missed %lu periods", missed);
 
         printf_c(Color_Green, "Moshe Loop ended");
 
-        xTaskNotify(htsk_eli, val++);
+        if ( xTaskMailboxSend(htsk_eli, val++) == false )
+            printf_c(Color_Yellow, "Eli's mailbox is full");
+
+        xTaskNotify(htsk_dana, 1);
     }
 }
 
@@ -64,9 +83,10 @@ void tsk_aviv(void *args)
         y = 0;
         printf_c(Color_Red, "Aviv Counting from 0 to %d", target);
 
+        /* Let the other tasks run every time slice rather than on every count */
         while ( y++ != target )
         {
-            taskYIELD();
+            xTaskYieldIfExpired();
         }
 
         printf_c(Color_Red, "Aviv done counting, taking 5 seconds break..");
@@ -76,7 +96,7 @@ void tsk_aviv(void *args)
 
 /**************************************************************************/ /**
  * @brief
- *  Task Eli: waits for any event.
+ *  Task Eli: waits for Moshe's counter values.
  * @return
  *   nothing.
  *
@@ -84,19 +104,65 @@ void tsk_aviv(void *args)
 
 void tsk_eli(void *args)
 {
-    uint32_t event;
+    uint64_t value;
 
     while ( 1 )
     {
-        printf_c(Color_Blue, "Eli Waiting for event");
+        printf_c(Color_Blue, "Eli Waiting for mail");
 
-        event = xTaskNotifyWait(HAL_XTASK_MAX_TIME);
+        if ( xTaskMailboxReceive(HAL_XTASK_MAX_TIME, &value) == false )
+            continue;
 
-        printf_c(Color_Blue, "Eli Got event %d, thinking about that for a while..", event);
+        printf_c(Color_Blue, "Eli Got %llu, thinking about that for a while..", value);
         vTaskDelay(2000);
     }
 }
 
+/**************************************************************************/ /**
+ * @brief
+ *  Stackless task Dana: counts Moshe's notifications, gives up after 5 quiet seconds
+ *  for a 3 seconds break. Runs on the scheduler stack, its state lives in 'args'.
+ * @return
+ *   XTaskPt_Waiting while blocked.
+ *
+ *****************************************************************************/
+
+XTask_PtState tsk_dana(XTask_PtTypeDef *pt, void *args)
+{
+    uint32_t *count = (uint32_t *) args;
+    uint32_t  event = 0;
+
+    XPT_BEGIN(pt);
+
+    while ( 1 )
+    {
+        XPT_WAIT_NOTIFY(pt, 5000, event);
+
+        if ( event )
+            printf_c(Color_White, "Dana got notification %lu", ++(*count));
+        else
+        {
+            printf_c(Color_White, "Dana timed out, taking 3 seconds break..");
+            XPT_DELAY(pt, 3000);
+        }
+    }
+
+    XPT_END(pt);
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Heartbeat timer: runs from the scheduler loop every 10 seconds, no task stack required.
+ * @return
+ *   nothing.
+ *
+ *****************************************************************************/
+
+void tmr_heartbeat(TimerHandle_t timer, void *args)
+{
+    printf_c(Color_Yellow, "Heartbeat");
+}
+
 /**************************************************************************/ /**
  * @brief
  *  Everything must have a beginning
@@ -110,13 +176,29 @@ int main(int argc, char *argv[])
     HAL_Enable_Colors();
     SetConsoleTitle("Scheduler");
 
+    /* '--virtual' runs the demo on simulated time, idle periods are skipped */
+    if ( argc > 1 && strcmp(argv[1], "--virtual") == 0 )
+        HAL_SetTimeSource(HAL_TimeSource_Virtual);
+
     HAL_InitTicks();
 
+    /* Warm up on a C++ configured instance, it ends once its task returns */
+    main_xsched_run();
+
     /* Create few tasks */
     htsk_moshe = xTaskCreate("TSK_MOSHE", tsk_moshe, 0x3000, NULL);
     htsk_aviv  = xTaskCreate("TSK_AVIV", tsk_aviv, 0x3000, NULL);
     htsk_eli   = xTaskCreate("TSK_ELI", tsk_eli, 0x3000, NULL);
 
+    /* A stackless one */
+    htsk_dana = xTaskCreateStackless(tsk_dana, &dana_count);
+
+    /* And C++ coroutines */
+    main_coro_create();
+
+    /* And a periodic timer */
+    xTimerStart(xTimerCreate("HEARTBEAT", 10000, true, tmr_heartbeat, NULL));
+
     /* Start the scheduler infinite loop */
     vTaskStartScheduler();
 
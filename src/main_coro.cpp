@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    main_coro.cpp
+  * @brief   Sample file that demonstrates C++20 coroutine tasks.
+  *
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+  * All rights reserved.</center></h2>
+  *
+  *
+  ******************************************************************************
+  */
+
+#include "hal.h"
+#include "xtask.hpp"
+
+using namespace std::chrono_literals;
+
+/* Jobs handed from Noa to Gil, in milliseconds of work */
+static xt::queue<uint32_t> gJobs;
+
+/**************************************************************************/ /**
+ * @brief
+ *  Coroutine Noa: queues a job every 3 seconds.
+ * @return
+ *   coroutine task.
+ *
+ *****************************************************************************/
+
+static xt::task coro_noa()
+{
+    uint32_t job = 0;
+
+    while ( true )
+    {
+        co_await xt::delay(3000ms);
+
+        job = (job + 500) % 2500;
+        printf_c(Color_Yellow, "Noa queued a %lu ms job", job);
+        gJobs.push(job);
+    }
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Coroutine Gil: works the jobs queued by Noa.
+ * @return
+ *   coroutine task.
+ *
+ *****************************************************************************/
+
+static xt::task coro_gil()
+{
+    while ( true )
+    {
+        uint32_t job = co_await gJobs.pop();
+
+        printf_c(Color_Yellow, "Gil working for %lu ms", job);
+        co_await xt::delay(std::chrono::milliseconds(job));
+    }
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Schedules the coroutines, next to the C tasks.
+ * @return
+ *   nothing.
+ *
+ *****************************************************************************/
+
+extern "C" void main_coro_create(void)
+{
+    xt::spawn(coro_noa());
+    xt::spawn(coro_gil());
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    main_xsched.cpp
+  * @brief   Sample file that demonstrates the policy configured C++ front-end.
+  *
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+  * All rights reserved.</center></h2>
+  *
+  *
+  ******************************************************************************
+  */
+
+#include "hal.h"
+#include "xsched.hpp"
+
+/* Warm up instance options: small stacks, watched tasks, no statistics */
+struct warmup_config : xt::default_config
+{
+    static constexpr uint32_t stack_size      = 0x3000;
+    static constexpr uint32_t watchdog_budget = 500;
+    static constexpr bool     collect_stats   = false;
+};
+
+using warmup = xt::scheduler<warmup_config>;
+
+/**************************************************************************/ /**
+ * @brief
+ *  Task Tal: blinks 3 times and returns, which ends the warm up instance.
+ * @return
+ *   nothing.
+ *
+ *****************************************************************************/
+
+static void tsk_tal(void *args)
+{
+    uint32_t lastWake = HAL_GetTick();
+
+    for ( uint32_t i = 1; i <= 3; i++ )
+    {
+        printf_c(Color_Blue, "Tal blink %lu of 3", i);
+        warmup::delay_until(&lastWake, 500);
+    }
+}
+
+/**************************************************************************/ /**
+ * @brief
+ *  Runs a configured scheduler instance until its only task returns.
+ * @return
+ *   nothing.
+ *
+ *****************************************************************************/
+
+extern "C" void main_xsched_run(void)
+{
+    warmup sched;
+
+    sched.create("TSK_TAL", tsk_tal, NULL);
+    sched.start();
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
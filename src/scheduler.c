@@ -18,57 +18,254 @@
 
 #include "scheduler.h"
 #include "hal.h"
-#include "llist.h"
+#include "timers.h"
+#include "workers.h"
 
-/* Memory protection value */
-#define HAL_XTASK_MEM_MARKER 0xcca55acc
+#include <ctype.h>
+#include <stddef.h>
+
+/* Memory protection values */
+#define HAL_XTASK_MEM_MARKER  0xcca55acc
+#define HAL_XSCHED_MEM_MARKER 0xcca66acc
+#define HAL_XFUTURE_MEM_MARKER 0xcca99acc
+#define HAL_XGROUP_MEM_MARKER  0xcca88acc
+
+/**
+  * @brief Scheduling state of a task, everything the dispatcher reads to decide whether
+  *        the task may run. Kept apart from the task context in a contiguous array, in the
+  *        tasks order, so a scheduler pass scans 4 tasks per cache line.
+  */
+
+typedef struct __XTask_HotTypeDef
+{
+    uint32_t events;           /* Events */
+    uint32_t delay_end;        /* Delay end time in ticks */
+    uint32_t event_expire_end; /* Event pending expiration tick value */
+    uint8_t  yielding;         /* Yielding state */
+    uint8_t  running;          /* Are we running? */
+    uint8_t  started;          /* Was the task entry point invoked? */
+    uint8_t  pendingEvent;     /* Waiting for event */
+
+} XTask_HotTypeDef;
+
+/**
+  * @brief Tasks joined together, see xTaskGroupWaitAll().
+  */
+
+typedef struct __XTask_GroupTypeDef
+{
+    uint32_t                   pending;    /* Count of tasks of the group still running */
+    struct __XTask_CtxTypeDef *waiter;     /* Task parked in xTaskGroupWaitAll(), NULL when none */
+    uint32_t                   mem_marker; /* Memory protection marker */
+    uint8_t                    released;   /* Deleted while tasks were pending, the last of them frees the group */
+
+} XTask_GroupTypeDef;
+
+/**
+  * @brief Task arena memory block, the allocations follow the header.
+  */
+
+typedef struct __XTask_ArenaTypeDef
+{
+    struct __XTask_ArenaTypeDef *next; /* Block filled up before this one */
+    uint32_t                     size; /* Bytes available for allocations */
+    uint32_t                     used; /* Bytes handed out */
+
+} XTask_ArenaTypeDef;
+
+/* Offset of the allocations in an arena block */
+#define XTASK_ARENA_HEADER_SIZE ((sizeof(XTask_ArenaTypeDef) + HAL_XTASK_ARENA_ALIGN - 1) & ~(HAL_XTASK_ARENA_ALIGN - 1))
+
+/**
+  * @brief Task mailbox ring, only allocated for the tasks that receive mail.
+  */
+
+typedef struct __XTask_MailboxTypeDef
+{
+    uint64_t mail[HAL_XTASK_MAILBOX_SIZE]; /* Values, see xTaskMailboxSend() */
+    uint8_t  head;                         /* Oldest value */
+    uint8_t  count;                        /* Values held */
+
+} XTask_MailboxTypeDef;
+
+/* What a task parked by xTaskNotifyWaitValue() or xTaskMailboxReceive() waits for */
+#define XTASK_WAIT_VALUE (1)
+#define XTASK_WAIT_MAIL  (2)
 
 /**
   * @brief Context descriptor associated with each running task.
   * @note  This context was carefully aligned, all pointers are
   *        located in an ALIGNED address.
+  *        The members up to 'sp_bottom' are common to all tasks, stackless tasks
+  *        allocate only that leading part, see XTASK_STACKLESS_CTX_SIZE.
+  *        The scheduling state lives in the hot records array, see XTASK_HOT().
   */
 
 typedef struct __XTask_CtxTypeDef
 {
     TaskFunction_t             cb;                              /* Task entry point (call back) */
     void *                     args;                            /* Task arguments */
+    uint32_t                   slot;                            /* Index of the task in the hot records and tasks arrays */
+    uint32_t                   ready_tick;                      /* Tick at which the task became ready to run */
+    uint32_t                   mem_marker;                      /* Memory protection  marker */
+    XTask_PtTypeDef            pt;                              /* Stackless task resume point */
+    XTask_GroupTypeDef *       group;                           /* Group the task belongs to, see xTaskGroupAdd() */
+    XTask_ArenaTypeDef *       arena;                           /* Arena block allocations are served from, see xTaskArenaAlloc() */
+    uint32_t                   arena_used;                      /* Arena bytes handed out since the last reset */
+    uint32_t                   arena_peak;                      /* Most arena bytes handed out between two resets */
+    uint32_t                   notify_value;                    /* Notification value, see xTaskNotifyValue() */
+    XTask_MailboxTypeDef *     mailbox;                         /* Allocated by the first xTaskMailboxSend(), NULL until then */
+    uint8_t                    stackless;                       /* Stackless task, the members below are not allocated */
+    uint8_t                    static_alloc;                    /* Context and stack reserved at compile time, see xTaskCreateStatic() */
+    uint8_t                    notify_pending;                  /* 'notify_value' was updated since it was last taken */
+    uint8_t                    waiting_for;                     /* XTASK_WAIT_VALUE or XTASK_WAIT_MAIL while parked for either */
     char *                     sp_bottom;                       /* Base stack pointer */
     char *                     sp_top;                          /* Base stack pointer */
-    uint32_t                   events;                          /* Events */
     uint32_t                   stak_size;                       /* Max stack allocated for the task in bytes */
     jmp_buf                    ctx_task;                        /* Long jump context */
     jmp_buf                    ctx_sched;                       /* Long jump context */
-    uint32_t                   delay_end;                       /* Delay end time in ticks */
-    uint32_t                   event_expire_end;                /* Event pending expiration tick value */
     uint32_t                   ticks_accumulated;               /* Total ticks spent by the task */
     uint32_t                   ticks_peek;                      /* Peek ticks spent by the task */
     uint32_t                   ticks_avg;                       /* Average ticks spent by the task */
     uint32_t                   ticks_start;                     /* Task start tick value */
+    uint32_t                   switches;                        /* Count of times the task was switched in */
+    uint32_t                   missed_periods;                  /* Periods skipped by vTaskDelayUntil() due to running late */
+    uint32_t                   budget;                          /* Watchdog run budget in ticks, 0 for the scheduler default */
+    uint32_t                   overruns;                        /* Times the task exceeded its run budget */
+    uint32_t                   overrun_peak;                    /* Longest run beyond the budget, in ticks */
+    uint32_t                   lat_hist[HAL_XTASK_LAT_BUCKETS]; /* Scheduling latency histogram, log2 milliseconds buckets */
+    uint32_t                   lat_sum;                         /* Sum of the scheduling latencies, in ticks */
     uint8_t                    name[HAL_XTASK_MAX_STRING_SIZE]; /* Task name */
-    uint8_t                    yielding;                        /* Yielding state */
-    uint8_t                    running;                         /* Are we running? */
-    uint8_t                    pendingEvent;                    /* Waiting for event */
     uint8_t                    stk_color;                       /* The initial state stack memory 'color' */
-    uint32_t                   mem_marker;                      /* Memory protection  marker */
-    struct __XTask_CtxTypeDef *next;                            /* Link next pointer */
+    uint8_t                    shared;                          /* Runs on the shared stack, see xTaskCreateShared() */
+    char *                     sp_saved;                        /* Shared stack: lowest address in use when the task switched out */
+    char *                     save_buf;                        /* Shared stack: used portion saved while another task owns the stack */
+    uint32_t                   save_size;                       /* Shared stack: bytes held by 'save_buf' */
+    uint32_t                   save_cap;                        /* Shared stack: bytes allocated for 'save_buf' */
 
 } XTask_CtxTypeDef;
 
+/**
+  * @brief Result of a call run by a child task, see xTaskSpawnFuture().
+  */
+
+typedef struct __XTask_FutureTypeDef
+{
+    FutureFunction_t           fn;         /* Call run by the child task */
+    void *                     arg;        /* Call argument */
+    void *                     result;     /* Call result, valid once 'done' is set */
+    struct __XTask_CtxTypeDef *waiter;     /* Task parked in xFutureAwait(), NULL when none */
+    uint32_t                   mem_marker; /* Memory protection marker */
+    uint8_t                    done;       /* The call returned */
+    uint8_t                    released;   /* Nobody awaits the result, the child task frees the future */
+    uint8_t                    failed;     /* The child task was released with its scheduler before the call returned */
+
+} XTask_FutureTypeDef;
+
+/**
+  * @brief Profiler sample, the task caught running and where, see vTaskSetProfiler().
+  */
+
+typedef struct __XTask_SampleTypeDef
+{
+    uint8_t  name[HAL_XTASK_MAX_STRING_SIZE]; /* Task name, zero padded */
+    uint32_t depth;                           /* Count of addresses in 'pc' */
+    uint32_t pc[HAL_XTASK_PROF_DEPTH];        /* Code addresses, innermost first, zero padded */
+
+} XTask_SampleTypeDef;
+
+/* Bytes allocated for a stackless task context */
+#define XTASK_STACKLESS_CTX_SIZE offsetof(XTask_CtxTypeDef, sp_bottom)
+
+/* Compile time checks that the storage reserved by XTASK_STATIC_TABLE() fits, the array size is negative otherwise */
+typedef char XTask_StaticCtxCheck[(sizeof(XTask_StaticCtxTypeDef) >= sizeof(XTask_CtxTypeDef)) ? 1 : -1];
+typedef char XTask_StaticHotCheck[(sizeof(XTask_StaticHotTypeDef) == sizeof(XTask_HotTypeDef)) ? 1 : -1];
+
+/* Initial count of slots in the tasks arrays, doubled as needed */
+#define XTASK_INITIAL_SLOTS 64
+
+/* A helper thread watches the running task for preemption and the watchdog */
+#define XTASK_MONITOR        ((HAL_XTASK_PREEMPTION > 0) || (HAL_XTASK_WATCHDOG > 0) || (HAL_XTASK_PROFILER > 0))
+#define XTASK_MONITOR_PERIOD 1 /* Milliseconds between checks */
+
 /**
   * @brief Module locals, note that all pointers are aligned.
   */
 
 typedef struct __XTask_ConfigTypeDef
 {
-    XTask_CtxTypeDef *cur;     /* Pointer to the current context being executed */
-    XTask_CtxTypeDef *head;    /* Pointer to the context list head */
-    uint8_t           running; /* Scheduler global running state ? */
+    XTask_CtxTypeDef *              cur;          /* Pointer to the current context being executed */
+    XTask_HotTypeDef *              hot;          /* Scheduling state of the tasks, in the order of their creation */
+    XTask_CtxTypeDef              **tasks;        /* Task contexts, same order, NULL for a released task until compacted */
+    uint32_t                        count;        /* Slots in use, including released ones */
+    uint32_t                        capacity;     /* Slots allocated */
+    uint32_t                        released;     /* Slots released since the last compaction */
+    const XTask_StaticTableTypeDef *static_table; /* Static task table whose arrays 'hot' and 'tasks' are, see xTaskCreateStatic() */
+    XTask_CtxTypeDef *              shared_owner; /* Task whose stack currently occupies the shared stack */
+    char *                          shared_stack; /* Execution stack of the shared stack tasks, allocated with the first of them */
+    uint8_t                         running;      /* Scheduler global running state ? */
+    uint8_t                         stop;         /* Scheduler stop was requested */
+    void *                          timers;       /* Timers list, managed by the timers module */
+    XWork_QueueTypeDef              work;         /* Calls offloaded by xTaskRunBlocking() and completed by the worker threads */
+    uint64_t                        slice_start;  /* Cycle counter value when the current task was switched in */
+    uint64_t                        slice_cycles; /* Time slice budget in cycles, see xTaskYieldIfExpired() */
+    uint32_t                        wakes;        /* Bumped whenever a task is readied or added from within a task */
+    uint32_t                        quiet_until;  /* Tick before which no other task can become ready by itself, 0 when unknown */
+    uint32_t                        quiet_wakes;  /* 'wakes' value when 'quiet_until' was computed */
+    uint32_t                        mem_marker;   /* Memory protection marker */
+
+#if ( XTASK_MONITOR > 0 )
+    volatile uint32_t dispatches;   /* Incremented when a task is switched in and out, odd while a task runs */
+    volatile uint8_t  monitor_quit; /* Asks the monitor thread to exit */
+    HANDLE            monitor;      /* Thread watching the running task, see xTaskMonitorThread() */
+    HANDLE            thread;       /* Thread running the scheduler, suspended for backtraces */
+#endif
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+    uint32_t          quantum; /* Preemption quantum in milliseconds, 0 when disabled */
+    volatile uint32_t preempt; /* Turn ('dispatches' value) whose task exceeded its quantum and should yield, 0 when none */
+#endif
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+    uint32_t             wd_budget;    /* Default run budget in ticks, 0 when disabled */
+    WatchdogFunction_t   wd_cb;        /* Overrun report call back, NULL to print it */
+    uint8_t              wd_backtrace; /* Capture the call stack of runaway tasks */
+    volatile uint32_t    wd_captured;  /* Turn ('dispatches' value) the report backtrace was captured in */
+    uint32_t             turn_start;   /* Tick the running task was switched in, or had its yield elided */
+    volatile uint32_t    turn_budget;  /* Run budget of the running task, 0 when not watched, for the monitor thread */
+    XTask_WatchdogReport wd_report;    /* Last overrun report */
+#endif
+
+#if ( HAL_XTASK_PROFILER > 0 )
+    uint32_t             prof_period;  /* Sampling period in milliseconds, 0 when disabled */
+    uint32_t             prof_last;    /* GetTickCount() value of the last sample */
+    XTask_SampleTypeDef *prof_samples; /* Samples ring, allocated when the profiler is first enabled */
+    uint32_t             prof_count;   /* Samples taken since the last reset, the ring keeps the latest */
+    CRITICAL_SECTION     prof_lock;    /* Guards the ring against the exporter */
+#endif
+
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+    XTask_ExportFormat export_format;                   /* Periodic statistics export format */
+    uint32_t           export_interval;                 /* Periodic statistics export interval in ticks, 0 when disabled */
+    uint32_t           export_last;                     /* Tick value of the last periodic export */
+    char               export_path[HAL_XTASK_MAX_PATH]; /* Periodic statistics export file */
+#endif
 
 } XTask_ConfigTypeDef;
 
-/* Container for this module globals */
-XTask_ConfigTypeDef gXTsk = {.head = NULL, .running = false, .cur = NULL};
+/* Default scheduler instance, the one used unless another one was selected */
+XTask_ConfigTypeDef gXTskDefault = {.hot = NULL, .tasks = NULL, .count = 0, .running = false, .stop = false, .cur = NULL, .mem_marker = HAL_XSCHED_MEM_MARKER};
+
+/* Scheduler instance selected by the calling thread, see xSchedulerSelect() */
+static __declspec(thread) XTask_ConfigTypeDef *gXTsk = &gXTskDefault;
+
+/* Scheduling state of a task, re-evaluated on each use since the array moves as it grows */
+#define XTASK_HOT(ctx) (gXTsk->hot[(ctx)->slot])
+
+/* Iterates the live tasks in their scheduling order */
+#define XTASK_FOREACH(i, ctx) \
+    for ( (i) = 0; (i) < gXTsk->count; (i)++ ) \
+        if ( ((ctx) = gXTsk->tasks[(i)]) != NULL )
 
 /**
   * @brief
@@ -76,10 +273,17 @@ XTask_ConfigTypeDef gXTsk = {.head = NULL, .running = false, .cur = NULL};
   *   using setjmp / longjmp.
   */
 
-#define vTaskJump(tsk)                  \
-    {                                   \
-        if ( ! setjmp(tsk->ctx_task) )  \
-            longjmp(tsk->ctx_sched, 1); \
+/* Stackless tasks return to the scheduler by themselves, see stackless.h.
+ * Shared stack tasks record how deep their stack is so it could be saved.
+ */
+#define vTaskJump(tsk)                                                                    \
+    {                                                                                     \
+        if ( ! tsk->stackless && ! setjmp(tsk->ctx_task) )                                \
+        {                                                                                 \
+            if ( tsk->shared )                                                            \
+                tsk->sp_saved = (char *) HAL_GetStackPointer() - HAL_XTASK_SHARED_MARGIN; \
+            longjmp(tsk->ctx_sched, 1);                                                   \
+        }                                                                                 \
     }
 
 #define vSchedJump(tsk)                 \
@@ -106,14 +310,18 @@ static XTask_CtxTypeDef *xTaskGetContext(void)
     uint32_t sp = (uint32_t) HAL_GetStackPointer();
 
     /* No active context ? */
-    if ( gXTsk.cur == NULL )
+    if ( gXTsk->cur == NULL )
         return NULL;
 
+    /* A stackless task runs on the scheduler stack, the current context is set only while it is being invoked */
+    if ( gXTsk->cur->stackless )
+        return (gXTsk->cur->mem_marker == HAL_XTASK_MEM_MARKER) ? gXTsk->cur : NULL;
+
     /* We can return the local task handle only if current SP is within the global tasks memory address space */
-    if ( HAL_VAL_IN_RANGE(sp, (uint32_t) gXTsk.cur->sp_bottom, (uint32_t) gXTsk.cur->sp_top) )
+    if ( HAL_VAL_IN_RANGE(sp, (uint32_t) gXTsk->cur->sp_bottom, (uint32_t) gXTsk->cur->sp_top) )
     {
-        if ( gXTsk.cur->mem_marker == HAL_XTASK_MEM_MARKER )
-            return gXTsk.cur; /* Return current task as a handle */
+        if ( gXTsk->cur->mem_marker == HAL_XTASK_MEM_MARKER )
+            return gXTsk->cur; /* Return current task as a handle */
     }
 
     /* If we're here, we couldn't map current stack to any of the running tasks */
@@ -124,6 +332,28 @@ static XTask_CtxTypeDef *xTaskGetContext(void)
 #endif
 }
 
+/**
+  * @brief Maps a task handle to its context within the selected scheduler instance.
+  *        The scheduling state is indexed in the instance of the calling thread, the tasks
+  *        of another instance, see xSchedulerSelect(), are rejected rather than having
+  *        another task's record modified.
+  * @param handle: handle (pointer) to a task structure.
+  * @retval Task context, NULL when the handle is invalid or belongs to another instance.
+  */
+
+static XTask_CtxTypeDef *xTaskFromHandle(TaskHandle_t handle)
+{
+    XTask_CtxTypeDef *ctx = (XTask_CtxTypeDef *) handle;
+
+    if ( ! ctx || handle == HAL_XTASK_INVALID_HANDLE || ctx->mem_marker != HAL_XTASK_MEM_MARKER )
+        return NULL;
+
+    if ( ctx->slot >= gXTsk->count || gXTsk->tasks[ctx->slot] != ctx )
+        return NULL;
+
+    return ctx;
+}
+
 /**
   * @brief Validate task stack prior to entering
   * @param handle: handle (pointer) to a task structure.
@@ -137,7 +367,7 @@ static bool xTaskValidate(XTask_CtxTypeDef *ctx)
     char *ptr = NULL;
     int   i   = 0;
 
-    if ( ctx && ctx->mem_marker == HAL_XTASK_MEM_MARKER )
+    if ( ctx && ctx->mem_marker == HAL_XTASK_MEM_MARKER && ! ctx->stackless )
     {
         /* Stack overflow protection , make sure that the last x byte of the stack base address
          * has the correct ' color'  and that the jump stack pointer is located at the correct boundaries
@@ -161,8 +391,9 @@ static bool xTaskValidate(XTask_CtxTypeDef *ctx)
 
 /**
   * @brief Return the stack usage in percentages.
+  * @note  Shared stack tasks report the usage of the shared stack, the same for all of them.
   * @param handle: handle (pointer) to a task structure.
-  * @retval usage in percentages or -1 on error;
+  * @retval usage in percentages or -1 on error, stackless tasks have no stack to measure;
   */
 
 int xTaskGetStackUsage(TaskHandle_t handle)
@@ -174,9 +405,9 @@ int xTaskGetStackUsage(TaskHandle_t handle)
     char *       ptr     = NULL;
     unsigned int freeMem = 0;
 
-    if ( ctx && handle != HAL_XTASK_INVALID_HANDLE && ctx->mem_marker == HAL_XTASK_MEM_MARKER )
+    if ( ctx && handle != HAL_XTASK_INVALID_HANDLE && ctx->mem_marker == HAL_XTASK_MEM_MARKER && ! ctx->stackless )
     {
-
+        /* Shared stack tasks point at the shared stack, painted as a whole when it was allocated */
         ptr = (char *) ctx->sp_bottom;
         while ( freeMem < ctx->stak_size )
         {
@@ -194,6 +425,49 @@ int xTaskGetStackUsage(TaskHandle_t handle)
     return usage;
 }
 
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+
+/**
+ * @brief Gets the stack usage of a task for a statistics report, the shared stack is
+ *        only scanned for the first shared stack task of the report.
+ * @param ctx: task context.
+ * @param shared: shared stack usage of the report, -1 until scanned.
+ * @retval usage in percentages, see xTaskGetStackUsage().
+ */
+
+static int xTaskReportStackUsage(XTask_CtxTypeDef *ctx, int *shared)
+{
+    if ( ! ctx->shared )
+        return xTaskGetStackUsage((TaskHandle_t) ctx);
+
+    if ( *shared < 0 )
+        *shared = xTaskGetStackUsage((TaskHandle_t) ctx);
+
+    return *shared;
+}
+
+#endif
+
+/**
+ * @brief Gets a printable name for the task state.
+ * @param ctx: task context.
+ * @retval State name.
+ */
+
+static const char *xTaskGetStateName(XTask_CtxTypeDef *ctx)
+{
+    if ( XTASK_HOT(ctx).running == false )
+        return "Stopped";
+
+    if ( XTASK_HOT(ctx).pendingEvent == true )
+        return "Pending";
+
+    if ( XTASK_HOT(ctx).delay_end > 0 )
+        return "Delaying";
+
+    return "Executing";
+}
+
 /**
  * @brief Dumps XTasks statistics
  * @param print: 'printf' implementation
@@ -207,11 +481,14 @@ void xTaskDumpStats(PrintfFn print)
 #if ( HAL_XTASK_COLLECT_STATS > 0 )
 
     int             tskCnt       = 0;
+    int             ptCnt        = 0;
     char            tskState[16] = {0};
     char            tskUsage[16] = {0};
     char            timeBuf[32]  = {0};
     HAL_TimeTypeDef timestamp;
-    int             ctxSize = sizeof(XTask_CtxTypeDef);
+    int             ctxSize = sizeof(XTask_CtxTypeDef) + sizeof(XTask_HotTypeDef);
+    int             shared  = -1;
+    uint32_t        i;
 
     XTask_CtxTypeDef *ctx = NULL;
 
@@ -219,34 +496,32 @@ void xTaskDumpStats(PrintfFn print)
     print("%-10s%-14s%-16s%-12s%-20s%-12s", "Name", "State", "Stack total", "Stack peek", "Time spent (H:m:s)", "Time peek (ms)");
     print("\r\n--------------------------------------------------------------------------------------\r\n\r\n");
 
-    LL_FOREACH(gXTsk.head, ctx)
+    XTASK_FOREACH(i, ctx)
     {
+        /* Stackless tasks carry no statistics, only count them */
+        if ( ctx->stackless )
+        {
+            ptCnt++;
+            continue;
+        }
+
         tskState[0] = 0;
         tskUsage[0] = 0;
         timeBuf[0]  = 0;
 
-        if ( ctx->running == false )
-            strncpy(tskState, "Stopped", sizeof(tskState) - 1);
-        else
-        {
-            if ( ctx->pendingEvent == true )
-                strncpy(tskState, "Pending", sizeof(tskState) - 1);
-            else if ( ctx->delay_end > 0 )
-                strncpy(tskState, "Delaying", sizeof(tskState) - 1);
-            else
-                strncpy(tskState, "Executing", sizeof(tskState) - 1);
-        }
+        strncpy(tskState, xTaskGetStateName(ctx), sizeof(tskState) - 1);
 
         /* Build a time stamp string */
         HAL_TicksToTime(&timestamp, (uint32_t) ctx->ticks_accumulated);
         snprintf(timeBuf, sizeof(timeBuf), "%02d.%02d:%02d", timestamp.hours, timestamp.minutes, timestamp.seconds);
 
-        snprintf(tskUsage, sizeof(tskUsage) - 1, "%d%%", xTaskGetStackUsage((TaskHandle_t) ctx));
+        snprintf(tskUsage, sizeof(tskUsage) - 1, ctx->shared ? "%d%% shared" : "%d%%", xTaskReportStackUsage(ctx, &shared));
         print("%-10s%-14s%-16d%-12s%-20s%-12lu\r\n", ctx->name, tskState, ctx->stak_size, tskUsage, timeBuf, ctx->ticks_peek);
         tskCnt++;
     }
 
     print("\r\nTotal running tasks: %d, context size: %d bytes.\r\n", tskCnt, ctxSize);
+    print("Stackless tasks: %d, context size: %d bytes.\r\n", ptCnt, (int) (XTASK_STACKLESS_CTX_SIZE + sizeof(XTask_HotTypeDef)));
     print("'Time spent' can only accumulate full milliseconds rather than fraction of a millisecond.\r\n", ctxSize);
 
 #else
@@ -258,262 +533,2814 @@ void xTaskDumpStats(PrintfFn print)
 #endif
 }
 
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+
 /**
-  * @brief Signals a task.
-  * @param handle: handle (pointer) to a task structure.
-  * @param event: event to signal.
-  * @retval none.
-  */
+ * @brief Registers a scheduling latency sample in the task histogram.
+ * @param ctx: task context.
+ * @param latency: ticks elapsed between the task becoming ready and being switched in.
+ * @retval None.
+ */
 
-void xTaskNotify(TaskHandle_t handle, uint32_t event)
+static void xTaskRecordLatency(XTask_CtxTypeDef *ctx, uint32_t latency)
 {
+    int bucket = 0;
 
-#if ( HAL_XTASK_ENABLED > 0 )
-
-    XTask_CtxTypeDef *ctx = (XTask_CtxTypeDef *) handle;
+    ctx->lat_sum += latency;
 
-    if ( ctx && handle != HAL_XTASK_INVALID_HANDLE && ctx->mem_marker == HAL_XTASK_MEM_MARKER )
+    /* Bucket 0 holds 0 ms, bucket n holds [2^(n-1), 2^n) ms, the last one holds everything beyond */
+    while ( latency > 0 && bucket < (HAL_XTASK_LAT_BUCKETS - 1) )
     {
-        HAL_SET_BIT(ctx->events, event);
+        latency >>= 1;
+        bucket++;
     }
 
-#endif
+    ctx->lat_hist[bucket]++;
 }
 
 /**
-  * @brief  Checks if there are any pending events, otherwise jump back to the scheduler.
-  *         The events will be auto cleared.
-  * @retval Event bits.
-  */
+ * @brief Estimates a scheduling latency percentile out of the task histogram.
+ * @param ctx: task context.
+ * @param percent: requested percentile (1..100).
+ * @retval Upper bound of the matching histogram bucket in ticks, 0 when no samples were taken.
+ */
 
-uint32_t xTaskNotifyWait(uint32_t ticksToWait)
+static uint32_t xTaskGetLatencyPercentile(XTask_CtxTypeDef *ctx, uint32_t percent)
 {
-    uint32_t stored = 0;
+    uint64_t total = 0;
+    uint64_t acc   = 0;
+    int      i;
 
-#if ( HAL_XTASK_ENABLED > 0 )
+    for ( i = 0; i < HAL_XTASK_LAT_BUCKETS; i++ )
+        total += ctx->lat_hist[i];
 
-    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+    if ( total == 0 )
+        return 0;
 
-    /* Make sure the context is valid and jump */
-    if ( ctx && ctx->running == true )
+    for ( i = 0; i < HAL_XTASK_LAT_BUCKETS; i++ )
     {
-        if ( ctx->events == 0 )
-        {
-            ctx->pendingEvent = true;
+        acc += ctx->lat_hist[i];
+        if ( acc * 100 >= total * percent )
+            break;
+    }
 
-            /* Set event pending expiration tick */
-            if ( ticksToWait > 0 && ticksToWait != HAL_XTASK_MAX_TIME )
-                ctx->event_expire_end = (HAL_GetTick() + ticksToWait);
+    return (i == 0) ? 0 : ((1UL << i) - 1);
+}
 
-            vTaskJump(ctx);
-        }
+/**
+ * @brief 'snprintf' style append into an export buffer.
+ * @note  Keeps counting once the buffer is exhausted so the caller learns the required size.
+ * @param buf: destination buffer, may be NULL when size is 0.
+ * @param size: destination buffer size in bytes.
+ * @param offset: running count of bytes produced so far.
+ * @retval None.
+ */
 
-        /* We're back from the context execution, we can return the pending event bits to the caller */
-        stored            = ctx->events;
-        ctx->pendingEvent = false;
-        ctx->events       = 0;
-    }
+static void xTaskExportAppend(char *buf, size_t size, int *offset, const char *format, ...)
+{
+    va_list list;
+    int     len;
+    size_t  pos = (size_t) *offset;
 
-#endif
-    return stored;
+    va_start(list, format);
+    len = vsnprintf((buf && pos < size) ? (buf + pos) : NULL, (pos < size) ? (size - pos) : 0, format, list);
+    va_end(list);
+
+    if ( len > 0 )
+        *offset += len;
 }
 
 /**
-  * @brief Jumps back to the scheduler and let other task do some work.
-  * @retval None.
-  */
+ * @brief Copies a task name while escaping the characters which are not allowed
+ *        inside a JSON string or a Prometheus label value.
+ * @param dst: destination buffer, at least twice the size of a task name.
+ * @param src: task name.
+ * @retval Destination buffer.
+ */
 
-void taskYIELD(void)
+static char *xTaskEscapeName(char *dst, const uint8_t *src)
 {
-#if ( HAL_XTASK_ENABLED > 0 )
-
-    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+    char *ptr = dst;
+    int   i   = 0;
 
-    /* Make sure the context is valid and jump */
-    if ( ctx && ctx->running == true )
+    while ( i < HAL_XTASK_MAX_STRING_SIZE && src[i] )
     {
-        ctx->yielding = true; /* Mark this context as yielding */
-        vTaskJump(ctx);
+        if ( src[i] == '"' || src[i] == '\\' )
+            *ptr++ = '\\';
+
+        *ptr++ = (char) src[i++];
     }
 
-#endif
+    *ptr = 0;
+    return dst;
 }
 
 /**
-  * @brief Mark the task as delayed for the required duration and jump back to the schedule.
-  * @param handle: handle (pointer) to a task structure.
-  * @retval None.
-  */
+ * @brief Copies a task name for a quoted CSV field, embedded quotes are doubled.
+ * @param dst: destination buffer, at least twice the size of a task name.
+ * @param src: task name.
+ * @retval Destination buffer.
+ */
 
-void vTaskDelay(uint32_t delay)
+static char *xTaskEscapeCsvName(char *dst, const uint8_t *src)
 {
-#if ( HAL_XTASK_ENABLED > 0 )
-
-    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+    char *ptr = dst;
+    int   i   = 0;
 
-    /* Make sure the context is valid and jump */
-    if ( ctx && ctx->running == true )
+    while ( i < HAL_XTASK_MAX_STRING_SIZE && src[i] )
     {
-        ctx->yielding = true;
-
-        /* Set delay expiration tick */
-        if ( delay > 0 )
-            ctx->delay_end = (HAL_GetTick() + delay);
+        if ( src[i] == '"' )
+            *ptr++ = '"';
 
-        vTaskJump(ctx);
+        *ptr++ = (char) src[i++];
     }
 
-#endif
+    *ptr = 0;
+    return dst;
 }
 
+#endif
+
 /**
-  * @brief Create a new task in memory in suspended state.
-  * @param name: NULL terminated string describing the task.
-  * @param cb: Task handler function`.
-  * @param stackSize: Stack to allocate for the stack.
-  * @retval valid handle to the newly created task.
-  */
+ * @brief Exports XTasks statistics in a machine readable format.
+ * @param format: requested output format.
+ * @param buf: destination buffer, can be NULL to query the required size.
+ * @param size: destination buffer size in bytes.
+ * @retval Count of bytes (excluding the NULL terminator) the full export requires,
+ *         when it is larger or equal to 'size' the output was truncated. -1 on error.
+ */
 
-TaskHandle_t xTaskCreate(char *name, TaskFunction_t cb, uint32_t stackSize, void *ptr)
+int xTaskExportStats(XTask_ExportFormat format, char *buf, size_t size)
 {
-#if ( HAL_XTASK_ENABLED > 0 )
+#if ( HAL_XTASK_ENABLED > 0 ) && ( HAL_XTASK_COLLECT_STATS > 0 )
 
-    XTask_CtxTypeDef *ctx       = NULL;
-    void *            stk_ptr   = NULL;
-    static char       stk_color = 'A';
+    XTask_CtxTypeDef *ctx     = NULL;
+    uint32_t          i       = 0;
+    int               offset  = 0;
+    int               first   = true;
+    uint32_t          now     = HAL_GetTick();
+    int               shared  = -1;
+    char              name[HAL_XTASK_MAX_STRING_SIZE * 2 + 1];
 
-    /* Not adding new tasks after the scheduler has been started */
-    if ( gXTsk.running == true )
-        return HAL_XTASK_INVALID_HANDLE;
+    if ( buf && size > 0 )
+        buf[0] = 0;
 
-    ctx = malloc(sizeof(XTask_CtxTypeDef));
-    if ( ! ctx )
-        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task node */
+    switch ( format )
+    {
+        case XTaskExport_JSON:
 
-    /* Clears task list member */
-    memset(ctx, 0, sizeof(XTask_CtxTypeDef));
+            xTaskExportAppend(buf, size, &offset, "{\"tick\":%lu,\"tasks\":[", now);
+            XTASK_FOREACH(i, ctx)
+            {
+                if ( ctx->stackless )
+                    continue;
+
+                xTaskExportAppend(buf, size, &offset,
+                                  "%s{\"name\":\"%s\",\"state\":\"%s\",\"stack_size\":%lu,\"stack_usage\":%d,\"stack_shared\":%s,"
+                                  "\"cpu_ms\":%lu,\"peek_ms\":%lu,\"switches\":%lu,\"missed_periods\":%lu,"
+                                  "\"latency_ms\":{\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu},"
+                                  "\"overruns\":%lu,\"overrun_peak_ms\":%lu,\"arena_bytes\":%lu,\"arena_peak_bytes\":%lu}",
+                                  first ? "" : ",", xTaskEscapeName(name, ctx->name), xTaskGetStateName(ctx), ctx->stak_size,
+                                  xTaskReportStackUsage(ctx, &shared), ctx->shared ? "true" : "false", ctx->ticks_accumulated, ctx->ticks_peek, ctx->switches,
+                                  ctx->missed_periods, xTaskGetLatencyPercentile(ctx, 50), xTaskGetLatencyPercentile(ctx, 90),
+                                  xTaskGetLatencyPercentile(ctx, 99), xTaskGetLatencyPercentile(ctx, 100), ctx->overruns, ctx->overrun_peak,
+                                  ctx->arena_used, ctx->arena_peak);
+                first = false;
+            }
+            xTaskExportAppend(buf, size, &offset, "]}\n");
+            break;
 
-    /* Initializes all of the task properties */
-    strncpy((char *) ctx->name, name, HAL_XTASK_MAX_STRING_SIZE);
-    ctx->mem_marker       = HAL_XTASK_MEM_MARKER;
-    ctx->cb               = cb;
-    ctx->args             = ptr;
-    ctx->events           = 0;
-    ctx->event_expire_end = HAL_XTASK_MAX_TIME;
-    ctx->sp_bottom        = (char *) malloc(stackSize + 1024);
-    ctx->sp_top           = ctx->sp_bottom + stackSize;
-    ctx->stak_size        = stackSize;
-    ctx->stk_color        = stk_color++;
-    ctx->next             = NULL;
+        case XTaskExport_CSV:
 
-    if ( ctx->sp_top == NULL )
-        return HAL_XTASK_INVALID_HANDLE;
+            xTaskExportAppend(buf, size, &offset, "tick,name,state,stack_size,stack_usage,cpu_ms,peek_ms,switches,missed_periods,lat_p50_ms,lat_p90_ms,lat_p99_ms,lat_max_ms,overruns,overrun_peak_ms,arena_bytes,arena_peak_bytes,stack_shared\n");
+            XTASK_FOREACH(i, ctx)
+            {
+                if ( ctx->stackless )
+                    continue;
+
+                xTaskExportAppend(buf, size, &offset, "%lu,\"%s\",%s,%lu,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d\n", now, xTaskEscapeCsvName(name, ctx->name),
+                                  xTaskGetStateName(ctx), ctx->stak_size, xTaskReportStackUsage(ctx, &shared), ctx->ticks_accumulated,
+                                  ctx->ticks_peek, ctx->switches, ctx->missed_periods, xTaskGetLatencyPercentile(ctx, 50),
+                                  xTaskGetLatencyPercentile(ctx, 90), xTaskGetLatencyPercentile(ctx, 99), xTaskGetLatencyPercentile(ctx, 100),
+                                  ctx->overruns, ctx->overrun_peak, ctx->arena_used, ctx->arena_peak, ctx->shared);
+            }
+            break;
 
-    memset(ctx->sp_bottom, ctx->stk_color, ctx->stak_size);
+        case XTaskExport_Prometheus:
 
-    /* Attach it to the tasks list */
-    LL_APPEND(gXTsk.head, ctx);
+            /* Each metric family is emitted once, followed by a sample per task. Names are not unique,
+             * the task handle tells the series apart.
+             */
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_info Task state, the value is always 1.\n# TYPE xtask_info gauge\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_info{task=\"%s\",handle=\"0x%08lx\",state=\"%s\"} 1\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, xTaskGetStateName(ctx));
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_stack_size_bytes Stack allocated for the task.\n# TYPE xtask_stack_size_bytes gauge\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_stack_size_bytes{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->stak_size);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_stack_usage_percent Peek stack usage, of the shared stack for the stack=\"shared\" tasks.\n# TYPE xtask_stack_usage_percent gauge\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_stack_usage_percent{task=\"%s\",handle=\"0x%08lx\",stack=\"%s\"} %d\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx,
+                                      ctx->shared ? "shared" : "own", xTaskReportStackUsage(ctx, &shared));
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_cpu_ms_total Milliseconds spent running the task.\n# TYPE xtask_cpu_ms_total counter\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_cpu_ms_total{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->ticks_accumulated);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_run_peek_ms Longest single run of the task.\n# TYPE xtask_run_peek_ms gauge\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_run_peek_ms{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->ticks_peek);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_switches_total Times the task was switched in.\n# TYPE xtask_switches_total counter\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_switches_total{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->switches);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_missed_periods_total Periods skipped by vTaskDelayUntil().\n# TYPE xtask_missed_periods_total counter\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_missed_periods_total{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->missed_periods);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_overruns_total Runs longer than the watchdog budget.\n# TYPE xtask_overruns_total counter\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_overruns_total{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->overruns);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_arena_bytes Arena bytes allocated since the last reset.\n# TYPE xtask_arena_bytes gauge\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_arena_bytes{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->arena_used);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_arena_peak_bytes Most arena bytes allocated between two resets.\n# TYPE xtask_arena_peak_bytes gauge\n");
+            XTASK_FOREACH(i, ctx)
+                if ( ! ctx->stackless )
+                    xTaskExportAppend(buf, size, &offset, "xtask_arena_peak_bytes{task=\"%s\",handle=\"0x%08lx\"} %lu\n", xTaskEscapeName(name, ctx->name), (uint32_t) ctx, ctx->arena_peak);
+
+            xTaskExportAppend(buf, size, &offset, "# HELP xtask_latency_ms Delay between becoming ready and running.\n# TYPE xtask_latency_ms summary\n");
+            XTASK_FOREACH(i, ctx)
+            {
+                if ( ctx->stackless )
+                    continue;
+
+                xTaskEscapeName(name, ctx->name);
+                xTaskExportAppend(buf, size, &offset, "xtask_latency_ms{task=\"%s\",handle=\"0x%08lx\",quantile=\"0.5\"} %lu\n", name, (uint32_t) ctx, xTaskGetLatencyPercentile(ctx, 50));
+                xTaskExportAppend(buf, size, &offset, "xtask_latency_ms{task=\"%s\",handle=\"0x%08lx\",quantile=\"0.9\"} %lu\n", name, (uint32_t) ctx, xTaskGetLatencyPercentile(ctx, 90));
+                xTaskExportAppend(buf, size, &offset, "xtask_latency_ms{task=\"%s\",handle=\"0x%08lx\",quantile=\"0.99\"} %lu\n", name, (uint32_t) ctx, xTaskGetLatencyPercentile(ctx, 99));
+                xTaskExportAppend(buf, size, &offset, "xtask_latency_ms_sum{task=\"%s\",handle=\"0x%08lx\"} %lu\n", name, (uint32_t) ctx, ctx->lat_sum);
+                xTaskExportAppend(buf, size, &offset, "xtask_latency_ms_count{task=\"%s\",handle=\"0x%08lx\"} %lu\n", name, (uint32_t) ctx, ctx->switches);
+            }
+            break;
 
-    // printf_c(Color_White, "'%s' created, stack bottpm: %p, top : %p", ctx->name, ctx->sp_bottom, ctx->sp_top);
+        default:
+            return -1;
+    }
 
-    return (TaskHandle_t) ctx;
+    return offset;
 
+#else
+    return -1;
 #endif
-    return HAL_XTASK_INVALID_HANDLE;
 }
 
 /**
-  * @brie Gets the task handle by iterating the tasks list.
-  * @retval task pointer if found, else NULL.
-  */
+ * @brief Exports XTasks statistics into a file.
+ * @note  The data is written to a temporary file which then replaces the destination,
+ *        so a scraper never reads a partially written export.
+ * @param format: requested output format.
+ * @param path: destination file path.
+ * @retval Boolean.
+ */
 
-TaskHandle_t xTaskGetHandle(void)
+bool xTaskExportStatsToFile(XTask_ExportFormat format, const char *path)
 {
-#if ( HAL_XTASK_ENABLED > 0 )
+#if ( HAL_XTASK_ENABLED > 0 ) && ( HAL_XTASK_COLLECT_STATS > 0 )
 
-    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+    char   tmpPath[HAL_XTASK_MAX_PATH + 4];
+    char * buf     = NULL;
+    FILE * file    = NULL;
+    int    size    = 0;
+    bool   success = false;
 
-    /* If the context is valid */
-    if ( ctx )
-        return (TaskHandle_t) ctx;
+    if ( path == NULL || strlen(path) >= HAL_XTASK_MAX_PATH )
+        return false;
 
-#endif
-    return HAL_XTASK_INVALID_HANDLE;
-}
+    /* Query the required size, then render the export */
+    size = xTaskExportStats(format, NULL, 0);
+    if ( size < 0 )
+        return false;
 
-/**
-  * @brief Enters the task for the first time.
-  * @retval Nothing
-  */
+    buf = malloc((size_t) size + 1);
+    if ( buf == NULL )
+        return false;
 
-void vTaskStart(XTask_CtxTypeDef *ctx)
-{
+    xTaskExportStats(format, buf, (size_t) size + 1);
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
 
-    /*
-    * This task has not been started yet. Assign a new stack
-    * pointer, run the task, and exit it at the end.
-	*/
-    register void *top = (void *) ctx->sp_top;
-    __asm
+    file = fopen(tmpPath, "wb");
+    if ( file )
     {
-			mov esp, top;
+        success = (fwrite(buf, 1, (size_t) size, file) == (size_t) size);
+        success = (fclose(file) == 0) && success;
+
+        if ( success )
+            success = (MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING) == TRUE);
     }
 
-    ctx->cb(ctx->args);
+    free(buf);
+    return success;
+
+#else
+    return false;
+#endif
 }
 
 /**
-  * @brief Start an endless task scheduler loop.
-  * @retval HAL Status type.
-  */
+ * @brief Sets the scheduler to periodically export statistics into a file.
+ * @param format: requested output format.
+ * @param path: destination file path.
+ * @param interval: export interval in ticks, 0 disables periodic exports.
+ * @retval Boolean.
+ */
 
-bool vTaskStartScheduler(void)
+bool vTaskSetStatsExport(XTask_ExportFormat format, const char *path, uint32_t interval)
 {
+#if ( HAL_XTASK_ENABLED > 0 ) && ( HAL_XTASK_COLLECT_STATS > 0 )
 
-#if ( HAL_XTASK_COLLECT_STATS > 0 )
-    uint32_t ticks_spent;
-#endif
-
-    /* Already running ? */
-    if ( gXTsk.running == true )
+    if ( interval > 0 && (path == NULL || strlen(path) >= HAL_XTASK_MAX_PATH) )
         return false;
 
-    /* No tasks to execute! */
-    if ( gXTsk.head == NULL )
-        return false;
+    gXTsk->export_interval = 0;
 
-    /* Useful, allow some time for the system to stabilize before starting the show */
-    HAL_Delay(100);
+    if ( interval > 0 )
+    {
+        strncpy(gXTsk->export_path, path, HAL_XTASK_MAX_PATH - 1);
+        gXTsk->export_format   = format;
+        gXTsk->export_last     = HAL_GetTick();
+        gXTsk->export_interval = interval;
+    }
+
+    return true;
+
+#else
+    return false;
+#endif
+}
+
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+
+/**
+  * @brief Exports the statistics once the periodic export interval elapsed, see vTaskSetStatsExport().
+  * @retval None.
+  */
+
+static void vTaskExportIfDue(void)
+{
+    if ( gXTsk->export_interval > 0 && (HAL_GetTick() - gXTsk->export_last) >= gXTsk->export_interval )
+    {
+        gXTsk->export_last = HAL_GetTick();
+        xTaskExportStatsToFile(gXTsk->export_format, gXTsk->export_path);
+    }
+}
+
+#endif
+
+/**
+  * @brief Signals a task of the selected scheduler instance, see xTaskFromHandle().
+  * @param handle: handle (pointer) to a task structure.
+  * @param event: event to signal.
+  * @retval none.
+  */
+
+void xTaskNotify(TaskHandle_t handle, uint32_t event)
+{
+
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskFromHandle(handle);
+
+    if ( ctx )
+    {
+        /* A waiting task becomes ready the moment it receives its first event */
+        if ( XTASK_HOT(ctx).pendingEvent == true && XTASK_HOT(ctx).events == 0 )
+            ctx->ready_tick = HAL_GetTick();
+
+        HAL_SET_BIT(XTASK_HOT(ctx).events, event);
+        gXTsk->wakes++;
+    }
+
+#endif
+}
+
+/**
+  * @brief  Checks if there are any pending events, otherwise jump back to the scheduler.
+  *         The events will be auto cleared.
+  * @retval Event bits.
+  */
+
+uint32_t xTaskNotifyWait(uint32_t ticksToWait)
+{
+    uint32_t stored = 0;
+
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    /* Stackless tasks cannot block here, they have to wait through XPT_WAIT_NOTIFY() */
+    if ( ctx && ctx->stackless )
+    {
+        xTaskPtNotifyWait(ticksToWait, &stored);
+        return stored;
+    }
+
+    /* Make sure the context is valid and jump */
+    if ( ctx && XTASK_HOT(ctx).running == true )
+    {
+        if ( XTASK_HOT(ctx).events == 0 )
+        {
+            XTASK_HOT(ctx).pendingEvent     = true;
+            XTASK_HOT(ctx).event_expire_end = HAL_XTASK_MAX_TIME;
+
+            /* Set event pending expiration tick */
+            if ( ticksToWait > 0 && ticksToWait != HAL_XTASK_MAX_TIME )
+                XTASK_HOT(ctx).event_expire_end = (HAL_GetTick() + ticksToWait);
+
+            ctx->ready_tick = XTASK_HOT(ctx).event_expire_end;
+
+            vTaskJump(ctx);
+        }
+
+        /* We're back from the context execution, we can return the pending event bits to the caller */
+        stored                      = XTASK_HOT(ctx).events;
+        XTASK_HOT(ctx).pendingEvent = false;
+        XTASK_HOT(ctx).events       = 0;
+    }
+
+#endif
+    return stored;
+}
+
+/**
+  * @brief  Stackless flavour of xTaskNotifyWait(), called twice by XPT_WAIT_NOTIFY():
+  *         first to arm the wait and again each time the task is resumed.
+  * @param  ticksToWait: wait expiration in ticks, 0 or HAL_XTASK_MAX_TIME wait forever.
+  * @param  events: receives the event bits once the wait is over, 0 when it expired.
+  * @retval false when the task has to return to the scheduler and wait, true when the wait is over.
+  */
+
+bool xTaskPtNotifyWait(uint32_t ticksToWait, uint32_t *events)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    *events = 0;
+
+    if ( ctx == NULL || XTASK_HOT(ctx).running == false || ! ctx->stackless )
+        return true;
+
+    /* Nothing signaled yet and not waiting, arm the wait */
+    if ( XTASK_HOT(ctx).events == 0 && XTASK_HOT(ctx).pendingEvent == false )
+    {
+        XTASK_HOT(ctx).pendingEvent     = true;
+        XTASK_HOT(ctx).event_expire_end = HAL_XTASK_MAX_TIME;
+
+        if ( ticksToWait > 0 && ticksToWait != HAL_XTASK_MAX_TIME )
+            XTASK_HOT(ctx).event_expire_end = (HAL_GetTick() + ticksToWait);
+
+        ctx->ready_tick = XTASK_HOT(ctx).event_expire_end;
+        return false;
+    }
+
+    /* Resumed, either signaled or expired */
+    *events                     = XTASK_HOT(ctx).events;
+    XTASK_HOT(ctx).pendingEvent = false;
+    XTASK_HOT(ctx).events       = 0;
+
+#endif
+    return true;
+}
+
+/**
+  * @brief Readies a parked task, see xTaskRunBlocking(), xFutureAwait() and xTaskMailboxReceive().
+  * @retval None.
+  */
+
+static void vTaskWake(XTask_CtxTypeDef *ctx)
+{
+    XTASK_HOT(ctx).delay_end = 0;
+    ctx->ready_tick          = HAL_GetTick();
+    gXTsk->wakes++;
+}
+
+/**
+  * @brief Parks the current stackful task until it is readied by vTaskWake() or the wait expires.
+  * @param what: XTASK_WAIT_VALUE or XTASK_WAIT_MAIL, tells the senders to ready the task.
+  * @param ticksToWait: ticks to wait, HAL_XTASK_MAX_TIME to wait with no deadline.
+  * @retval None.
+  */
+
+static void vTaskWaitFor(XTask_CtxTypeDef *ctx, uint8_t what, uint32_t ticksToWait)
+{
+    if ( XTASK_HOT(ctx).running == false || ctx->stackless )
+        return;
+
+    ctx->waiting_for        = what;
+    XTASK_HOT(ctx).yielding = true;
+    ctx->ready_tick         = HAL_GetTick();
+
+    if ( ticksToWait == HAL_XTASK_MAX_TIME )
+    {
+        XTASK_HOT(ctx).delay_end = HAL_XTASK_MAX_TIME;
+    }
+    else
+    {
+        XTASK_HOT(ctx).delay_end = (ctx->ready_tick + ticksToWait);
+        ctx->ready_tick          = XTASK_HOT(ctx).delay_end;
+    }
+
+    vTaskJump(ctx);
+    ctx->waiting_for = 0;
+}
+
+/**
+  * @brief Updates the notification value of a task, readying the task when it waits for it.
+  *        Unlike the event bits of xTaskNotify(), the value carries data: a count, an index
+  *        or a word of flags, depending on 'action'.
+  * @param handle: handle (pointer) to a task structure.
+  * @param value: value applied according to 'action'.
+  * @param action: how the value is updated.
+  * @retval false when the handle is not valid or belongs to another scheduler instance, or
+  *         XTaskNotify_SetIfEmpty found a value not taken yet.
+  */
+
+bool xTaskNotifyValue(TaskHandle_t handle, uint32_t value, XTask_NotifyAction action)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskFromHandle(handle);
+
+    if ( ctx == NULL )
+        return false;
+
+    switch ( action )
+    {
+        case XTaskNotify_SetBits:
+            HAL_SET_BIT(ctx->notify_value, value);
+            break;
+
+        case XTaskNotify_Increment:
+            ctx->notify_value++;
+            break;
+
+        case XTaskNotify_SetIfEmpty:
+            if ( ctx->notify_pending )
+                return false;
+
+            ctx->notify_value = value;
+            break;
+
+        default:
+            ctx->notify_value = value;
+            break;
+    }
+
+    ctx->notify_pending = true;
+
+    if ( ctx->waiting_for == XTASK_WAIT_VALUE )
+    {
+        ctx->waiting_for = 0;
+        vTaskWake(ctx);
+    }
+
+    return true;
+
+#endif
+    return false;
+}
+
+/**
+  * @brief  Takes the notification value of the current task, waiting for an update when none is
+  *         pending. The value is reset to 0 once taken, so XTaskNotify_Increment counts the
+  *         notifications between two takes. Stackless tasks only poll, they wait through
+  *         XPT_WAIT_UNTIL(pt, xTaskNotifyWaitValue(0, &value)).
+  * @param  ticksToWait: ticks to wait, 0 to poll, HAL_XTASK_MAX_TIME to wait with no deadline.
+  * @param  value: receives the notification value.
+  * @retval false when the value was not updated in time.
+  */
+
+bool xTaskNotifyWaitValue(uint32_t ticksToWait, uint32_t *value)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    if ( ctx == NULL )
+        return false;
+
+    if ( ctx->notify_pending == false && ticksToWait > 0 )
+        vTaskWaitFor(ctx, XTASK_WAIT_VALUE, ticksToWait);
+
+    if ( ctx->notify_pending == false )
+        return false;
+
+    *value              = ctx->notify_value;
+    ctx->notify_value   = 0;
+    ctx->notify_pending = false;
+    return true;
+
+#endif
+    return false;
+}
+
+/**
+  * @brief Queues a value into the mailbox of a task, readying the task when it waits for mail.
+  *        The mailbox holds HAL_XTASK_MAILBOX_SIZE values, 32 bits values and pointers fit as well,
+  *        so work items are passed without shared globals. It is allocated along with the first
+  *        value, tasks never receiving mail do not pay for it.
+  * @param handle: handle (pointer) to a task structure.
+  * @param value: value to queue.
+  * @retval false when the handle is not valid or belongs to another scheduler instance, the mailbox
+  *         is full or could not be allocated.
+  */
+
+bool xTaskMailboxSend(TaskHandle_t handle, uint64_t value)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskFromHandle(handle);
+
+    if ( ctx == NULL )
+        return false;
+
+    if ( ctx->mailbox == NULL )
+    {
+        ctx->mailbox = malloc(sizeof(XTask_MailboxTypeDef));
+        if ( ctx->mailbox == NULL )
+            return false;
+
+        memset(ctx->mailbox, 0, sizeof(XTask_MailboxTypeDef));
+    }
+
+    if ( ctx->mailbox->count == HAL_XTASK_MAILBOX_SIZE )
+        return false;
+
+    ctx->mailbox->mail[(ctx->mailbox->head + ctx->mailbox->count) % HAL_XTASK_MAILBOX_SIZE] = value;
+    ctx->mailbox->count++;
+
+    if ( ctx->waiting_for == XTASK_WAIT_MAIL )
+    {
+        ctx->waiting_for = 0;
+        vTaskWake(ctx);
+    }
+
+    return true;
+
+#endif
+    return false;
+}
+
+/**
+  * @brief  Takes the oldest value of the mailbox of the current task, waiting for one when the
+  *         mailbox is empty. Stackless tasks only poll, they wait through
+  *         XPT_WAIT_UNTIL(pt, xTaskMailboxReceive(0, &value)).
+  * @param  ticksToWait: ticks to wait, 0 to poll, HAL_XTASK_MAX_TIME to wait with no deadline.
+  * @param  value: receives the value.
+  * @retval false when no value arrived in time.
+  */
+
+bool xTaskMailboxReceive(uint32_t ticksToWait, uint64_t *value)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    if ( ctx == NULL )
+        return false;
+
+    if ( (ctx->mailbox == NULL || ctx->mailbox->count == 0) && ticksToWait > 0 )
+        vTaskWaitFor(ctx, XTASK_WAIT_MAIL, ticksToWait);
+
+    if ( ctx->mailbox == NULL || ctx->mailbox->count == 0 )
+        return false;
+
+    *value             = ctx->mailbox->mail[ctx->mailbox->head];
+    ctx->mailbox->head = (uint8_t) ((ctx->mailbox->head + 1) % HAL_XTASK_MAILBOX_SIZE);
+    ctx->mailbox->count--;
+    return true;
+
+#endif
+    return false;
+}
+
+/**
+  * @brief Checks whether a task may run on this turn, only its hot record is read.
+  * @param hot: task scheduling state.
+  * @param now: current tick.
+  * @retval Boolean.
+  */
+
+static bool xTaskIsReady(const XTask_HotTypeDef *hot, uint32_t now)
+{
+    if ( hot->running == false )
+        return false;
+
+    /* First turn */
+    if ( hot->started == false )
+        return true;
+
+    /* Check if event expiration tick was set and reached, HAL_XTASK_MAX_TIME waits forever rather than for that tick */
+    if ( hot->yielding == true || hot->events || (hot->event_expire_end != HAL_XTASK_MAX_TIME && now >= hot->event_expire_end) )
+    {
+        /* Check if delay interval was set and expired, HAL_XTASK_MAX_TIME parks the task until it is readied */
+        return (hot->delay_end == 0 || (hot->delay_end != HAL_XTASK_MAX_TIME && hot->delay_end <= now));
+    }
+
+    return false;
+}
+
+/**
+  * @brief Checks whether a task other than the current one, a timer or a completion is due.
+  *        The scan starts past the current task, where the next ready task usually is.
+  * @note  A scan finding nothing ready caches the earliest deadline of the other tasks, until
+  *        then only a wake up (see 'wakes') can ready one, so the next yields skip the scan.
+  *        The cache is dropped whenever the scheduler switches in a task.
+  * @retval Boolean.
+  */
+
+static bool xTaskOthersReady(XTask_CtxTypeDef *ctx)
+{
+    uint32_t now   = HAL_GetTick();
+    uint32_t quiet = HAL_XTASK_MAX_TIME;
+    uint32_t i, n;
+
+    /* Expired timers and completed offloaded calls are served by the scheduler loop */
+    if ( xTimerGetNextExpiry() <= now || gXTsk->work.head != NULL )
+        return true;
+
+    if ( gXTsk->quiet_wakes == gXTsk->wakes && now < gXTsk->quiet_until )
+        return false;
+
+    for ( n = 1, i = ctx->slot; n < gXTsk->count; n++ )
+    {
+        if ( ++i == gXTsk->count )
+            i = 0;
+
+        if ( xTaskIsReady(&gXTsk->hot[i], now) == true )
+            return true;
+
+        /* Same deadlines as xTaskGetNextDeadline(), a task may become ready no sooner */
+        if ( gXTsk->hot[i].running == false )
+            continue;
+
+        if ( gXTsk->hot[i].delay_end > 0 )
+            quiet = HAL_MIN(quiet, gXTsk->hot[i].delay_end);
+        else if ( gXTsk->hot[i].pendingEvent == true )
+            quiet = HAL_MIN(quiet, gXTsk->hot[i].event_expire_end);
+    }
+
+    gXTsk->quiet_until = quiet;
+    gXTsk->quiet_wakes = gXTsk->wakes;
+
+    return false;
+}
+
+/**
+  * @brief Jumps back to the scheduler and let other task do some work.
+  * @note  With HAL_XTASK_YIELD_ELISION a stackful task keeps running when no other task
+  *        is ready, the round trip through the scheduler would only bring it back. The
+  *        periodic statistics export is still served then, see vTaskSetStatsExport().
+  * @retval true when the task was switched out, false when the yield was elided or
+  *         outside of a task.
+  */
+
+static bool xTaskYield(void)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    /* Make sure the context is valid and jump */
+    if ( ctx && XTASK_HOT(ctx).running == true )
+    {
+#if ( HAL_XTASK_YIELD_ELISION > 0 )
+
+        /* Nothing else to run, carry on with a fresh time slice as if switched in again */
+        if ( ! ctx->stackless && gXTsk->stop == false && xTaskOthersReady(ctx) == false )
+        {
+            gXTsk->slice_start = HAL_GetCycles();
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+            gXTsk->preempt = 0;
+#endif
+
+#if ( XTASK_MONITOR > 0 )
+            gXTsk->dispatches += 2;
+#endif
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+            gXTsk->turn_start = HAL_GetTick();
+#endif
+
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+            vTaskExportIfDue();
+#endif
+            return false;
+        }
+#endif
+
+        XTASK_HOT(ctx).yielding = true; /* Mark this context as yielding */
+        ctx->ready_tick         = HAL_GetTick();
+        vTaskJump(ctx);
+        return true;
+    }
+
+#endif
+    return false;
+}
+
+/**
+  * @brief Jumps back to the scheduler and let other task do some work, see xTaskYield().
+  * @retval None.
+  */
+
+void taskYIELD(void)
+{
+    xTaskYield();
+}
+
+/**
+  * @brief Yields only once the task has used up its time slice, meant for long computations.
+  *        Cheap enough to be called on every iteration: it reads the cycle counter and returns
+  *        until the slice budget, see vTaskSetTimeSlice(), is exceeded. Also a preemption
+  *        point, see vTaskSetPreemption().
+  * @retval true when the slice was over and the task was switched out, false when it kept
+  *         running, including when the yield was elided, always false outside of a stackful task.
+  */
+
+bool xTaskYieldIfExpired(void)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx;
+    bool              expired = false;
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+    expired = (gXTsk->preempt != 0 && gXTsk->preempt == gXTsk->dispatches);
+#endif
+
+    if ( expired == false && (HAL_GetCycles() - gXTsk->slice_start) < gXTsk->slice_cycles )
+        return false;
+
+    /* Only a stackful task is switched out here, a stackless one yields by returning */
+    ctx = xTaskGetContext();
+    if ( ctx == NULL || ctx->stackless )
+        return false;
+
+    return xTaskYield();
+
+#else
+    return false;
+#endif
+}
+
+/**
+  * @brief Sets the time slice budget used by xTaskYieldIfExpired().
+  * @param us: slice duration in microseconds.
+  * @retval None.
+  */
+
+void vTaskSetTimeSlice(uint32_t us)
+{
+    gXTsk->slice_cycles = (HAL_GetCycleFrequency() * us) / 1000000;
+}
+
+/**
+  * @brief Walks the frame pointer chain of a task within its stack.
+  * @note  Relies on frame pointers, release builds need /Oy-.
+  * @param ip: code address the task is at.
+  * @param fp: frame pointer of the task.
+  * @param ctx: task context.
+  * @param pc: receives the code addresses, innermost first.
+  * @param depth: room in 'pc'.
+  * @retval Count of addresses stored.
+  */
+
+static uint32_t xTaskWalkStack(uint32_t ip, uint32_t fp, XTask_CtxTypeDef *ctx, uint32_t *pc, uint32_t depth)
+{
+    uint32_t  count = 0;
+    uint32_t *frame = (uint32_t *) fp;
+
+    pc[count++] = ip;
+
+    /* Each frame holds the caller frame pointer followed by the return address, the task entry
+     * frame has null ones, see vTaskStart().
+     */
+    while ( count < depth && ((uint32_t) frame & 3) == 0 &&
+            HAL_VAL_IN_RANGE((uint32_t) frame, (uint32_t) ctx->sp_bottom, (uint32_t) ctx->sp_top - 8) )
+    {
+        if ( frame[1] == 0 )
+            break;
+
+        pc[count++] = frame[1];
+
+        if ( frame[0] <= (uint32_t) frame )
+            break;
+
+        frame = (uint32_t *) frame[0];
+    }
+
+    return count;
+}
+
+/**
+  * @brief Gets the registers a parked task resumes with, saved by setjmp() in its jump buffer.
+  * @retval false when the task holds no saved context: stackless, not started yet or running.
+  */
+
+static bool xTaskGetSavedContext(XTask_CtxTypeDef *ctx, uint32_t *sp, uint32_t *fp, uint32_t *pc)
+{
+    const _JUMP_BUFFER *jmp = (const _JUMP_BUFFER *) ctx->ctx_task;
+
+    if ( ctx->stackless || XTASK_HOT(ctx).started == false || ctx == gXTsk->cur )
+        return false;
+
+    *sp = (uint32_t) jmp->Esp;
+    *fp = (uint32_t) jmp->Ebp;
+    *pc = (uint32_t) jmp->Eip;
+
+    return true;
+}
+
+/**
+  * @brief Lists the stacks of the tasks of the selected scheduler instance, for debuggers, crash
+  *        handlers and tools which have to tell the stacks apart from the rest of the memory.
+  *        Stackless tasks have no stack of their own and are not listed.
+  * @param info: receives the stacks, in the tasks order.
+  * @param max: room in 'info'.
+  * @retval Count of stacks, which may exceed 'max', only 'max' of them are then stored.
+  */
+
+uint32_t xTaskGetStacks(XTask_StackInfo *info, uint32_t max)
+{
+    XTask_CtxTypeDef *ctx   = NULL;
+    uint32_t          count = 0;
+    uint32_t          i;
+
+    XTASK_FOREACH(i, ctx)
+    {
+        if ( ctx->stackless )
+            continue;
+
+        if ( info && count < max )
+        {
+            memset(&info[count], 0, sizeof(XTask_StackInfo));
+
+            info[count].handle = (TaskHandle_t) ctx;
+            info[count].name   = (const char *) ctx->name;
+            info[count].bottom = (uint32_t) ctx->sp_bottom;
+            info[count].top    = (uint32_t) ctx->sp_top;
+            info[count].shared = ctx->shared;
+
+            xTaskGetSavedContext(ctx, &info[count].sp, &info[count].fp, &info[count].pc);
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+/**
+  * @brief Dumps the tasks of the selected scheduler instance along with their stack ranges, the
+  *        context they are parked in and its call stack.
+  * @param print: 'printf' implementation
+  * @retval None.
+  */
+
+void xTaskDumpContexts(PrintfFn print)
+{
+    XTask_CtxTypeDef *ctx = NULL;
+    uint32_t          pc[HAL_XTASK_BACKTRACE_DEPTH];
+    uint32_t          sp, fp, ip, depth, i, n;
+
+    print("\r\n");
+
+    XTASK_FOREACH(i, ctx)
+    {
+        if ( ctx->stackless )
+        {
+            print("Stackless task 0x%08lx, entry 0x%08lx, resume point %lu\r\n", (uint32_t) ctx, (uint32_t) ctx->cb, ctx->pt.lc);
+            continue;
+        }
+
+        print("Task '%s' 0x%08lx, %s, stack 0x%08lx-0x%08lx%s\r\n", ctx->name, (uint32_t) ctx, xTaskGetStateName(ctx),
+              (uint32_t) ctx->sp_bottom, (uint32_t) ctx->sp_top, ctx->shared ? " (shared)" : "");
+
+        if ( xTaskGetSavedContext(ctx, &sp, &fp, &ip) == false )
+            continue;
+
+        print("  esp 0x%08lx ebp 0x%08lx eip 0x%08lx\r\n", sp, fp, ip);
+
+        /* The stack of a shared stack task is elsewhere while another one occupies the shared stack */
+        if ( ctx->shared && gXTsk->shared_owner != ctx )
+            continue;
+
+        depth = xTaskWalkStack(ip, fp, ctx, pc, HAL_XTASK_BACKTRACE_DEPTH);
+        for ( n = 0; n < depth; n++ )
+            print("  #%lu 0x%08lx\r\n", n, pc[n]);
+    }
+}
+
+#if ( XTASK_MONITOR > 0 )
+
+/**
+  * @brief Suspends the scheduler thread from the monitor thread, provided the task found running
+  *        in turn 'dispatches' still is, and gets its registers. Nothing may be allocated nor
+  *        locked until the thread is resumed, it could hold the heap lock.
+  * @param sched: scheduler instance.
+  * @param dispatches: turn the task was found running in.
+  * @retval true when suspended, ResumeThread() is then up to the caller.
+  */
+
+static bool xTaskSuspendRunning(XTask_ConfigTypeDef *sched, uint32_t dispatches, CONTEXT *context)
+{
+    if ( SuspendThread(sched->thread) == (DWORD) -1 )
+        return false;
+
+    context->ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER;
+
+    /* The task may have switched out right before being suspended */
+    if ( sched->dispatches == dispatches && GetThreadContext(sched->thread, context) )
+        return true;
+
+    ResumeThread(sched->thread);
+    return false;
+}
+
+#endif
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+
+/**
+  * @brief Captures the call stack of a runaway task from the monitor thread.
+  * @param sched: scheduler instance.
+  * @param dispatches: turn the task was found running in.
+  * @retval None.
+  */
+
+static void vTaskCaptureBacktrace(XTask_ConfigTypeDef *sched, uint32_t dispatches)
+{
+    XTask_WatchdogReport *report = &sched->wd_report;
+    CONTEXT               context;
+
+    if ( xTaskSuspendRunning(sched, dispatches, &context) == false )
+        return;
+
+    /* The turn is confirmed and the thread suspended, the task context cannot go away meanwhile */
+    report->depth      = xTaskWalkStack((uint32_t) context.Eip, (uint32_t) context.Ebp, sched->cur, report->backtrace, HAL_XTASK_BACKTRACE_DEPTH);
+    sched->wd_captured = dispatches;
+
+    ResumeThread(sched->thread);
+}
+
+/**
+  * @brief Prints an overrun report, used when no call back was set.
+  * @retval None.
+  */
+
+static void vTaskWatchdogPrint(const XTask_WatchdogReport *report)
+{
+    uint32_t i;
+
+    printf("\r\nWatchdog: task '%s' ran %lu ms without yielding, budget %lu ms, stack usage %d%%\r\n", report->name,
+           report->duration, report->budget, report->stack_usage);
+
+    for ( i = 0; i < report->depth; i++ )
+        printf("  #%lu 0x%08lx\r\n", i, report->backtrace[i]);
+}
+
+/**
+  * @brief Checks a task that just switched out against its run budget, reports overruns.
+  * @retval None.
+  */
+
+static void vTaskWatchdogCheck(XTask_CtxTypeDef *ctx)
+{
+    XTask_WatchdogReport *report   = &gXTsk->wd_report;
+    uint32_t              budget   = ctx->budget ? ctx->budget : gXTsk->wd_budget;
+    uint32_t              duration = HAL_GetTick() - gXTsk->turn_start;
+
+    if ( budget == 0 || duration <= budget )
+        return;
+
+    ctx->overruns++;
+    ctx->overrun_peak = HAL_MAX(ctx->overrun_peak, duration);
+
+    /* The backtrace is only valid when captured during this very turn */
+    if ( gXTsk->wd_captured != gXTsk->dispatches - 1 )
+        report->depth = 0;
+
+    report->handle      = (TaskHandle_t) ctx;
+    report->name        = (const char *) ctx->name;
+    report->duration    = duration;
+    report->budget      = budget;
+    report->stack_usage = xTaskGetStackUsage((TaskHandle_t) ctx);
+
+    if ( gXTsk->wd_cb )
+        gXTsk->wd_cb(report);
+    else
+        vTaskWatchdogPrint(report);
+}
+
+#endif
+
+#if ( HAL_XTASK_PROFILER > 0 )
+
+/**
+  * @brief Takes a profiler sample from the monitor thread: the running task and the innermost
+  *        frames of its call stack, or the scheduler loop itself between two turns.
+  * @retval None.
+  */
+
+static void vTaskProfileSample(XTask_ConfigTypeDef *sched)
+{
+    XTask_SampleTypeDef sample;
+    uint32_t            dispatches = sched->dispatches;
+    XTask_CtxTypeDef *  ctx        = sched->cur;
+    CONTEXT             context;
+
+    memset(&sample, 0, sizeof(sample));
+    strncpy((char *) sample.name, "[scheduler]", sizeof(sample.name));
+
+    if ( (dispatches & 1) && ctx && xTaskSuspendRunning(sched, dispatches, &context) )
+    {
+        /* Stackless tasks run on the scheduler stack and carry no name */
+        if ( ctx->stackless )
+        {
+            strncpy((char *) sample.name, "[stackless]", sizeof(sample.name));
+            sample.pc[0] = (uint32_t) context.Eip;
+            sample.depth = 1;
+        }
+        else
+        {
+            memcpy(sample.name, ctx->name, sizeof(sample.name));
+            sample.depth = xTaskWalkStack((uint32_t) context.Eip, (uint32_t) context.Ebp, ctx, sample.pc, HAL_XTASK_PROF_DEPTH);
+        }
+
+        ResumeThread(sched->thread);
+    }
+
+    EnterCriticalSection(&sched->prof_lock);
+    sched->prof_samples[sched->prof_count++ % HAL_XTASK_PROF_SAMPLES] = sample;
+    LeaveCriticalSection(&sched->prof_lock);
+}
+
+#endif
+
+#if ( XTASK_MONITOR > 0 )
+
+/**
+  * @brief Monitor thread, watches for how long the running task has been running.
+  *        It requests the preemption of the turn once the quantum is over, captures the task
+  *        backtrace once its watchdog budget is exceeded and takes the profiler samples.
+  * @retval Thread exit code.
+  */
+
+static DWORD WINAPI xTaskMonitorThread(LPVOID param)
+{
+    XTask_ConfigTypeDef *sched = (XTask_ConfigTypeDef *) param;
+    uint32_t             seen  = 0;
+    uint32_t             since = GetTickCount();
+    uint32_t             dispatches, elapsed;
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+    uint32_t budget;
+#endif
+
+    while ( sched->monitor_quit == false )
+    {
+        Sleep(XTASK_MONITOR_PERIOD);
+
+#if ( HAL_XTASK_PROFILER > 0 )
+        if ( sched->prof_period > 0 && GetTickCount() - sched->prof_last >= sched->prof_period )
+        {
+            sched->prof_last = GetTickCount();
+            vTaskProfileSample(sched);
+        }
+#endif
+
+        /* Another turn started meanwhile, restart the clock */
+        dispatches = sched->dispatches;
+        if ( dispatches != seen )
+        {
+            seen  = dispatches;
+            since = GetTickCount();
+            continue;
+        }
+
+        /* Back in the scheduler loop */
+        if ( (dispatches & 1) == 0 )
+            continue;
+
+        elapsed = GetTickCount() - since;
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+        /* The request names the turn, a task switched in since the read of 'dispatches' ignores it */
+        if ( sched->quantum > 0 && elapsed >= sched->quantum )
+            sched->preempt = dispatches;
+#endif
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+        /* Only the instance is read here, the scheduler thread may free the running task meanwhile.
+         * A budget of a later turn is harmless, the capture checks the turn once suspended.
+         */
+        budget = sched->turn_budget;
+        if ( sched->wd_backtrace && sched->wd_captured != dispatches && budget > 0 && elapsed > budget )
+            vTaskCaptureBacktrace(sched, dispatches);
+#endif
+    }
+
+    return 0;
+}
+
+/**
+  * @brief Stops the monitor thread of the selected scheduler instance.
+  * @retval None.
+  */
+
+static void vTaskMonitorStop(void)
+{
+    if ( gXTsk->monitor == NULL )
+        return;
+
+    gXTsk->monitor_quit = true;
+    WaitForSingleObject(gXTsk->monitor, INFINITE);
+    CloseHandle(gXTsk->monitor);
+    gXTsk->monitor = NULL;
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+    gXTsk->preempt = 0;
+#endif
+
+    CloseHandle(gXTsk->thread);
+    gXTsk->thread = NULL;
+}
+
+/**
+  * @brief Starts or stops the monitor thread of the running scheduler instance,
+  *        depending on whether preemption or watchdog backtraces are enabled.
+  * @retval false when the thread could not be started.
+  */
+
+static bool vTaskMonitorUpdate(void)
+{
+    bool needed = false;
+
+    if ( gXTsk->running == false )
+        return true; /* Started along with the scheduler */
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+    needed |= (gXTsk->quantum > 0);
+#endif
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+    needed |= (gXTsk->wd_backtrace != 0);
+#endif
+
+#if ( HAL_XTASK_PROFILER > 0 )
+    needed |= (gXTsk->prof_period > 0);
+#endif
+
+    if ( needed == false )
+    {
+        vTaskMonitorStop();
+        return true;
+    }
+
+    if ( gXTsk->monitor != NULL )
+        return true;
+
+    /* A real handle to the scheduler thread, the monitor suspends it to capture backtraces */
+    if ( ! DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &gXTsk->thread, 0, FALSE, DUPLICATE_SAME_ACCESS) )
+        return false;
+
+    gXTsk->monitor_quit = false;
+    gXTsk->monitor      = CreateThread(NULL, 0, xTaskMonitorThread, gXTsk, 0, NULL);
+
+    return (gXTsk->monitor != NULL);
+}
+
+#endif
+
+#if ( HAL_XTASK_PREEMPTION > 0 )
+
+/**
+  * @brief Opt-in preemption: a task running longer than 'quantum' without switching out is
+  *        asked to yield, which it does at its next preemption point, xTaskPreemptionPoint()
+  *        or xTaskYieldIfExpired(). Tasks are never interrupted elsewhere.
+  * @param quantum: quantum in milliseconds, 0 to disable. The resolution is the system
+  *        timer resolution.
+  * @retval false when the monitor thread could not be started.
+  */
+
+bool vTaskSetPreemption(uint32_t quantum)
+{
+    gXTsk->quantum = quantum;
+    return vTaskMonitorUpdate();
+}
+
+/**
+  * @brief Preemption point, yields when the task has exceeded its quantum.
+  *        Costs a flag test otherwise, meant to be sprinkled over long running code.
+  * @retval true when the task was switched out, false when it kept running, including when
+  *         the yield was elided, always false outside of a stackful task.
+  */
+
+bool xTaskPreemptionPoint(void)
+{
+    XTask_CtxTypeDef *ctx;
+
+    if ( gXTsk->preempt == 0 || gXTsk->preempt != gXTsk->dispatches )
+        return false;
+
+    /* Only a stackful task is switched out here, a stackless one yields by returning */
+    ctx = xTaskGetContext();
+    if ( ctx == NULL || ctx->stackless )
+        return false;
+
+    return xTaskYield();
+}
+
+#endif
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+
+/**
+  * @brief Enables the runaway task watchdog: a task running longer than its budget without
+  *        switching out is reported once it switches out, along with its stack usage and,
+  *        optionally, the call stack it was caught in. Stackless tasks are not watched.
+  * @param budget: default run budget in ticks, 0 to disable, see vTaskSetBudget().
+  * @param cb: report call back, invoked from the scheduler loop, NULL to print the reports.
+  * @param backtrace: capture the call stack of runaway tasks from a helper thread.
+  * @retval false when the monitor thread could not be started.
+  */
+
+bool vTaskSetWatchdog(uint32_t budget, WatchdogFunction_t cb, bool backtrace)
+{
+    gXTsk->wd_budget    = budget;
+    gXTsk->wd_cb        = cb;
+    gXTsk->wd_backtrace = backtrace;
+
+    return vTaskMonitorUpdate();
+}
+
+/**
+  * @brief Sets the watchdog run budget of a task, overriding the scheduler default.
+  * @param budget: run budget in ticks, 0 to use the default one.
+  * @retval Boolean.
+  */
+
+bool vTaskSetBudget(TaskHandle_t handle, uint32_t budget)
+{
+    XTask_CtxTypeDef *ctx = xTaskFromHandle(handle);
+
+    if ( ctx == NULL || ctx->stackless )
+        return false;
+
+    ctx->budget = budget;
+    return true;
+}
+
+#endif
+
+#if ( HAL_XTASK_PROFILER > 0 )
+
+/**
+  * @brief Enables the sampling profiler: every 'period' milliseconds the monitor thread records
+  *        which task is running and the innermost frames of its call stack, or that the scheduler
+  *        loop itself is. The latest HAL_XTASK_PROF_SAMPLES samples are kept, see xTaskExportProfile().
+  * @param period: sampling period in milliseconds, 0 to stop sampling, the samples are kept.
+  *        The resolution is the system timer resolution.
+  * @retval false when there was no memory for the samples or the monitor thread could not be started.
+  */
+
+bool vTaskSetProfiler(uint32_t period)
+{
+    if ( period > 0 && gXTsk->prof_samples == NULL )
+    {
+        gXTsk->prof_samples = malloc(HAL_XTASK_PROF_SAMPLES * sizeof(XTask_SampleTypeDef));
+        if ( gXTsk->prof_samples == NULL )
+            return false;
+
+        InitializeCriticalSection(&gXTsk->prof_lock);
+    }
+
+    gXTsk->prof_period = period;
+    gXTsk->prof_last   = GetTickCount();
+
+    return vTaskMonitorUpdate();
+}
+
+/**
+  * @brief Discards the profiler samples taken so far.
+  * @retval None.
+  */
+
+void vTaskResetProfile(void)
+{
+    if ( gXTsk->prof_samples == NULL )
+        return;
+
+    EnterCriticalSection(&gXTsk->prof_lock);
+    gXTsk->prof_count = 0;
+    LeaveCriticalSection(&gXTsk->prof_lock);
+}
+
+/**
+  * @brief Orders samples so identical ones are adjacent.
+  * @retval memcmp() style result.
+  */
+
+static int xTaskCompareSamples(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(XTask_SampleTypeDef));
+}
+
+/**
+  * @brief Writes the profiler samples in the folded stacks format used by flame graph tools: one
+  *        line per distinct task and call stack, from the outermost frame to the innermost one,
+  *        followed by its count of samples, e.g. "Moshe;0x00401a2c;0x00401b10 42".
+  * @retval false when there were no samples or the file could not be written.
+  */
+
+bool xTaskExportProfile(const char *path)
+{
+    XTask_SampleTypeDef *samples = NULL;
+    FILE *               file    = NULL;
+    char                 root[HAL_XTASK_MAX_STRING_SIZE + 1];
+    uint32_t             count, i, j, n;
+
+    if ( gXTsk->prof_samples == NULL || path == NULL )
+        return false;
+
+    /* Work on a copy, the monitor thread keeps sampling meanwhile */
+    EnterCriticalSection(&gXTsk->prof_lock);
+
+    count = HAL_MIN(gXTsk->prof_count, HAL_XTASK_PROF_SAMPLES);
+    if ( count > 0 && (samples = malloc(count * sizeof(XTask_SampleTypeDef))) != NULL )
+        memcpy(samples, gXTsk->prof_samples, count * sizeof(XTask_SampleTypeDef));
+
+    LeaveCriticalSection(&gXTsk->prof_lock);
+
+    if ( samples == NULL )
+        return false;
+
+    qsort(samples, count, sizeof(XTask_SampleTypeDef), xTaskCompareSamples);
+
+    file = fopen(path, "w");
+    if ( file )
+    {
+        for ( i = 0; i < count; i = j )
+        {
+            for ( j = i + 1; j < count && xTaskCompareSamples(&samples[i], &samples[j]) == 0; j++ )
+                ;
+
+            /* Frames are separated by ';' and the count follows a space, keep them out of the task name */
+            for ( n = 0; n < HAL_XTASK_MAX_STRING_SIZE && samples[i].name[n]; n++ )
+                root[n] = (samples[i].name[n] == ';' || isspace(samples[i].name[n])) ? '_' : (char) samples[i].name[n];
+
+            root[n] = 0;
+            fprintf(file, "%s", root);
+
+            for ( n = samples[i].depth; n > 0; n-- )
+                fprintf(file, ";0x%08lx", samples[i].pc[n - 1]);
+
+            fprintf(file, " %lu\n", j - i);
+        }
+
+        fclose(file);
+    }
+
+    free(samples);
+    return (file != NULL);
+}
+
+#endif
+
+/**
+  * @brief Mark the task as delayed for the required duration and jump back to the schedule.
+  * @param handle: handle (pointer) to a task structure.
+  * @retval None.
+  */
+
+void vTaskDelay(uint32_t delay)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    /* Make sure the context is valid and jump */
+    if ( ctx && XTASK_HOT(ctx).running == true )
+    {
+        XTASK_HOT(ctx).yielding = true;
+        ctx->ready_tick         = HAL_GetTick();
+
+        /* Set delay expiration tick */
+        if ( delay > 0 )
+        {
+            XTASK_HOT(ctx).delay_end = (ctx->ready_tick + delay);
+            ctx->ready_tick          = XTASK_HOT(ctx).delay_end;
+        }
+
+        vTaskJump(ctx);
+    }
+
+#endif
+}
+
+/**
+  * @brief Delays the task until an absolute deadline, for drift free periodic execution.
+  *        The deadline is one period past the previous one regardless of how long the task ran.
+  *        When the task runs so late that deadlines have already passed they are skipped rather
+  *        than executed back to back, so the task keeps its original phase.
+  * @param lastWake: holds the previous deadline, initialize it with HAL_GetTick() before the first call.
+  *        Updated with the deadline the task is woken at.
+  * @param period: period in ticks.
+  * @retval Count of periods skipped due to running late, 0 when on time.
+  */
+
+uint32_t vTaskDelayUntil(uint32_t *lastWake, uint32_t period)
+{
+    uint32_t missed = 0;
+
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+    uint32_t          now, next;
+
+    /* Make sure the context is valid and jump */
+    if ( ctx && XTASK_HOT(ctx).running == true && lastWake && period > 0 )
+    {
+        now  = HAL_GetTick();
+        next = *lastWake + period;
+
+        /* Late, move to the first deadline still ahead (wrap around safe) */
+        if ( (int32_t) (next - now) < 0 )
+        {
+            missed = (now - next) / period + 1;
+            next += missed * period;
+
+            /* Stackless contexts end before the statistics, the caller still gets the count */
+            if ( ! ctx->stackless )
+                ctx->missed_periods += missed;
+        }
+
+        *lastWake                = next;
+        XTASK_HOT(ctx).yielding  = true;
+        XTASK_HOT(ctx).delay_end = next;
+        ctx->ready_tick          = next;
+
+        vTaskJump(ctx);
+    }
+
+#endif
+    return missed;
+}
+
+/**
+  * @brief Runs a blocking call on a worker thread, the task is parked until it returns
+  *        while the other tasks keep running.
+  * @note  Stackless and shared stack tasks, and callers outside of any task, run the call
+  *        in place: the stack of a shared stack task is moved while it is parked, so 'arg'
+  *        could not point into it.
+  * @param fn: blocking call, must not use the scheduler API.
+  * @param arg: call argument.
+  * @retval Call result.
+  */
+
+void *xTaskRunBlocking(BlockingFunction_t fn, void *arg)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef * ctx  = xTaskGetContext(); /* Find current context */
+    XWork_ItemTypeDef *item = NULL;
+    void *             result;
+
+    if ( ctx && XTASK_HOT(ctx).running == true && ! ctx->stackless && ! ctx->shared )
+        item = malloc(sizeof(XWork_ItemTypeDef));
+
+    if ( item )
+    {
+        memset(item, 0, sizeof(XWork_ItemTypeDef));
+        item->fn    = fn;
+        item->arg   = arg;
+        item->owner = ctx;
+
+        if ( xWorkSubmit(item, &gXTsk->work) == true )
+        {
+            /* Parked, there is no deadline until the completion readies the task */
+            XTASK_HOT(ctx).yielding  = true;
+            XTASK_HOT(ctx).delay_end = HAL_XTASK_MAX_TIME;
+
+            vTaskJump(ctx);
+
+            result = item->result;
+            free(item);
+            return result;
+        }
+
+        free(item);
+    }
+
+#endif
+    return fn(arg);
+}
+
+/**
+  * @brief Readies the tasks whose offloaded call completed, called by the scheduler loop.
+  * @retval Count of tasks readied.
+  */
+
+static uint32_t xTaskProcessCompletions(void)
+{
+    XWork_ItemTypeDef *item = xWorkCollect(&gXTsk->work);
+    XTask_CtxTypeDef * ctx;
+    uint32_t           count = 0;
+
+    for ( ; item; item = item->next, count++ )
+    {
+        ctx = (XTask_CtxTypeDef *) item->owner;
+        vTaskWake(ctx);
+    }
+
+    return count;
+}
+
+/**
+  * @brief Child task entry point, runs the future call and hands its result over.
+  * @retval None.
+  */
+
+static void vTaskFutureEntry(void *args)
+{
+    XTask_FutureTypeDef *future = (XTask_FutureTypeDef *) args;
+
+    future->result = future->fn(future->arg);
+    future->done   = true;
+
+    if ( future->released )
+    {
+        future->mem_marker = 0;
+        free(future);
+    }
+    else if ( future->waiter )
+    {
+        vTaskWake(future->waiter);
+    }
+}
+
+/**
+  * @brief Runs a call in a child task of the current scheduler instance, its result is
+  *        picked up later with xFutureAwait(). The child is started on the next scheduler pass.
+  * @param fn: call to run, it may use the scheduler API as any other task.
+  * @param arg: call argument.
+  * @retval Future handle, HAL_XFUTURE_INVALID_HANDLE when there was no memory for the child task.
+  */
+
+FutureHandle_t xTaskSpawnFuture(FutureFunction_t fn, void *arg)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_FutureTypeDef *future;
+
+    if ( fn == NULL )
+        return HAL_XFUTURE_INVALID_HANDLE;
+
+    future = malloc(sizeof(XTask_FutureTypeDef));
+    if ( future == NULL )
+        return HAL_XFUTURE_INVALID_HANDLE; /* No memory for the future */
+
+    memset(future, 0, sizeof(XTask_FutureTypeDef));
+    future->fn         = fn;
+    future->arg        = arg;
+    future->mem_marker = HAL_XFUTURE_MEM_MARKER;
+
+    if ( xTaskCreate("FUTURE", vTaskFutureEntry, HAL_XTASK_FUTURE_STACK_SIZE, future) == HAL_XTASK_INVALID_HANDLE )
+    {
+        free(future);
+        return HAL_XFUTURE_INVALID_HANDLE; /* No memory for the child task */
+    }
+
+    return (FutureHandle_t) future;
+
+#endif
+    return HAL_XFUTURE_INVALID_HANDLE;
+}
+
+/**
+  * @brief Waits for the call of a future to complete and hands back its result. The future
+  *        is released once its result was handed back, and must not be used afterwards.
+  *        A stackful task is parked meanwhile, stackless tasks and callers outside of a task
+  *        only poll the future, wait for xFutureIsDone() first.
+  * @param future: handle returned by xTaskSpawnFuture().
+  * @param timeout: ticks to wait, 0 to poll, HAL_XTASK_MAX_TIME to wait with no deadline.
+  * @param result: receives the call result, may be NULL.
+  * @retval false when the call did not complete in time, or never will since its scheduler was
+  *         ended meanwhile, the future remains valid.
+  */
+
+bool xFutureAwait(FutureHandle_t future, uint32_t timeout, void **result)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_FutureTypeDef *f   = (XTask_FutureTypeDef *) future;
+    XTask_CtxTypeDef *   ctx = xTaskGetContext(); /* Find current context */
+
+    if ( ! f || future == HAL_XFUTURE_INVALID_HANDLE || f->mem_marker != HAL_XFUTURE_MEM_MARKER || f->released )
+        return false;
+
+    /* The child task was released along with its scheduler, the call will never complete */
+    if ( f->failed )
+        return false;
+
+    /* A single task may wait on a future */
+    if ( f->done == false && timeout > 0 && f->waiter == NULL && ctx && XTASK_HOT(ctx).running == true && ! ctx->stackless )
+    {
+        f->waiter               = ctx;
+        XTASK_HOT(ctx).yielding = true;
+        ctx->ready_tick         = HAL_GetTick();
+
+        /* Parked, the child task readies the waiter as it completes */
+        if ( timeout == HAL_XTASK_MAX_TIME )
+        {
+            XTASK_HOT(ctx).delay_end = HAL_XTASK_MAX_TIME;
+        }
+        else
+        {
+            XTASK_HOT(ctx).delay_end = (ctx->ready_tick + timeout);
+            ctx->ready_tick          = XTASK_HOT(ctx).delay_end;
+        }
+
+        vTaskJump(ctx);
+        f->waiter = NULL;
+    }
+
+    if ( f->done == false )
+        return false;
+
+    if ( result )
+        *result = f->result;
+
+    f->mem_marker = 0;
+    free(f);
+    return true;
+
+#endif
+    return false;
+}
+
+/**
+  * @brief Checks whether the call of a future completed, xFutureAwait() would then return at once.
+  * @retval Boolean.
+  */
+
+bool xFutureIsDone(FutureHandle_t future)
+{
+    XTask_FutureTypeDef *f = (XTask_FutureTypeDef *) future;
+
+    if ( ! f || future == HAL_XFUTURE_INVALID_HANDLE || f->mem_marker != HAL_XFUTURE_MEM_MARKER )
+        return false;
+
+    return f->done;
+}
+
+/**
+  * @brief Gives up on the result of a future, the future is freed as soon as its call completed.
+  *        The handle must not be used afterwards.
+  * @retval None.
+  */
+
+void vFutureRelease(FutureHandle_t future)
+{
+    XTask_FutureTypeDef *f = (XTask_FutureTypeDef *) future;
+
+    if ( ! f || future == HAL_XFUTURE_INVALID_HANDLE || f->mem_marker != HAL_XFUTURE_MEM_MARKER || f->released )
+        return;
+
+    if ( f->done || f->failed )
+    {
+        f->mem_marker = 0;
+        free(f);
+        return;
+    }
+
+    f->released = true;
+}
+
+/**
+  * @brief Creates an empty task group.
+  * @retval Group handle, HAL_XGROUP_INVALID_HANDLE when there was no memory.
+  */
+
+TaskGroupHandle_t xTaskGroupCreate(void)
+{
+    XTask_GroupTypeDef *group = malloc(sizeof(XTask_GroupTypeDef));
+
+    if ( group == NULL )
+        return HAL_XGROUP_INVALID_HANDLE;
+
+    memset(group, 0, sizeof(XTask_GroupTypeDef));
+    group->mem_marker = HAL_XGROUP_MEM_MARKER;
+
+    return (TaskGroupHandle_t) group;
+}
+
+/**
+  * @brief Adds a task to a group, to be done before the task gets a chance to end, typically
+  *        right after creating it. A task belongs to a single group.
+  * @retval false when the task or the group is invalid, the task belongs to another scheduler
+  *         instance, or the task is in a group already.
+  */
+
+bool xTaskGroupAdd(TaskGroupHandle_t group, TaskHandle_t handle)
+{
+    XTask_GroupTypeDef *g   = (XTask_GroupTypeDef *) group;
+    XTask_CtxTypeDef *  ctx = xTaskFromHandle(handle);
+
+    if ( ! g || group == HAL_XGROUP_INVALID_HANDLE || g->mem_marker != HAL_XGROUP_MEM_MARKER || g->released )
+        return false;
+
+    if ( ctx == NULL || ctx->group )
+        return false;
+
+    ctx->group = g;
+    g->pending++;
+    return true;
+}
+
+/**
+  * @brief Takes an ending task out of its group, readying the group waiter with the last task.
+  * @retval None.
+  */
+
+static void vTaskGroupLeave(XTask_CtxTypeDef *ctx)
+{
+    XTask_GroupTypeDef *g = ctx->group;
+
+    ctx->group = NULL;
+    if ( --g->pending > 0 )
+        return;
+
+    if ( g->released )
+    {
+        g->mem_marker = 0;
+        free(g);
+    }
+    else if ( g->waiter )
+    {
+        vTaskWake(g->waiter);
+    }
+}
+
+/**
+  * @brief Waits for all the tasks of a group to end, the group may be reused afterwards.
+  *        A stackful task is parked meanwhile, stackless tasks and callers outside of a task
+  *        only poll the group.
+  * @param timeout: ticks to wait, 0 to poll, HAL_XTASK_MAX_TIME to wait with no deadline.
+  * @retval false when tasks of the group are still running.
+  */
+
+bool xTaskGroupWaitAll(TaskGroupHandle_t group, uint32_t timeout)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_GroupTypeDef *g   = (XTask_GroupTypeDef *) group;
+    XTask_CtxTypeDef *  ctx = xTaskGetContext(); /* Find current context */
+
+    if ( ! g || group == HAL_XGROUP_INVALID_HANDLE || g->mem_marker != HAL_XGROUP_MEM_MARKER || g->released )
+        return false;
+
+    /* A task waiting on its own group would never be readied */
+    if ( g->pending > 0 && timeout > 0 && g->waiter == NULL && ctx && ctx->group != g && XTASK_HOT(ctx).running == true && ! ctx->stackless )
+    {
+        g->waiter               = ctx;
+        XTASK_HOT(ctx).yielding = true;
+        ctx->ready_tick         = HAL_GetTick();
+
+        /* Parked, the last task of the group readies the waiter as it ends */
+        if ( timeout == HAL_XTASK_MAX_TIME )
+        {
+            XTASK_HOT(ctx).delay_end = HAL_XTASK_MAX_TIME;
+        }
+        else
+        {
+            XTASK_HOT(ctx).delay_end = (ctx->ready_tick + timeout);
+            ctx->ready_tick          = XTASK_HOT(ctx).delay_end;
+        }
+
+        vTaskJump(ctx);
+        g->waiter = NULL;
+    }
+
+    return (g->pending == 0);
+
+#endif
+    return false;
+}
+
+/**
+  * @brief Deletes a task group, the tasks it holds keep running.
+  *        The handle must not be used afterwards.
+  * @retval None.
+  */
+
+void vTaskGroupDelete(TaskGroupHandle_t group)
+{
+    XTask_GroupTypeDef *g = (XTask_GroupTypeDef *) group;
+
+    if ( ! g || group == HAL_XGROUP_INVALID_HANDLE || g->mem_marker != HAL_XGROUP_MEM_MARKER || g->released )
+        return;
+
+    if ( g->pending == 0 )
+    {
+        g->mem_marker = 0;
+        free(g);
+        return;
+    }
+
+    g->released = true;
+}
+
+/**
+  * @brief Allocates memory from the arena of the running task, a bump of a pointer in
+  *        the common case. The memory is not freed one allocation at a time, rather all
+  *        at once by xTaskArenaReset() or when the task ends.
+  * @param size: count of bytes, rounded up to HAL_XTASK_ARENA_ALIGN.
+  * @retval Allocated memory, NULL when out of memory or called outside of a task.
+  */
+
+void *xTaskArenaAlloc(uint32_t size)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *  ctx = xTaskGetContext(); /* Find current context */
+    XTask_ArenaTypeDef *block;
+    uint32_t            bytes;
+    char *              ptr;
+
+    if ( ctx == NULL || size == 0 )
+        return NULL;
+
+    /* Neither the rounding nor the block header may wrap the size around */
+    if ( size > UINT32_MAX - XTASK_ARENA_HEADER_SIZE - HAL_XTASK_ARENA_ALIGN )
+        return NULL;
+
+    size  = (size + HAL_XTASK_ARENA_ALIGN - 1) & ~(HAL_XTASK_ARENA_ALIGN - 1);
+    block = ctx->arena;
+
+    /* The current block is full, start a new one */
+    if ( block == NULL || block->size - block->used < size )
+    {
+        bytes = HAL_MAX(HAL_XTASK_ARENA_BLOCK_SIZE, size);
+        block = malloc(XTASK_ARENA_HEADER_SIZE + bytes);
+        if ( block == NULL )
+            return NULL;
+
+        block->next = ctx->arena;
+        block->size = bytes;
+        block->used = 0;
+        ctx->arena  = block;
+    }
+
+    ptr = (char *) block + XTASK_ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+
+    ctx->arena_used += size;
+    ctx->arena_peak = HAL_MAX(ctx->arena_peak, ctx->arena_used);
+
+    return ptr;
+
+#endif
+    return NULL;
+}
+
+/**
+  * @brief Releases at once all the memory allocated by the running task with xTaskArenaAlloc(),
+  *        typically at the end of each iteration of the task loop. When the arena had grown to
+  *        several blocks they are merged into a single one, so a steady state iteration is
+  *        served without calling malloc().
+  * @retval None.
+  */
+
+void xTaskArenaReset(void)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *  ctx = xTaskGetContext(); /* Find current context */
+    XTask_ArenaTypeDef *block, *next;
+    uint32_t            bytes = 0;
+
+    if ( ctx == NULL || ctx->arena == NULL )
+        return;
+
+    ctx->arena_used = 0;
+
+    if ( ctx->arena->next == NULL )
+    {
+        ctx->arena->used = 0;
+        return;
+    }
+
+    for ( block = ctx->arena; block; block = next )
+    {
+        next = block->next;
+        bytes += block->size;
+        free(block);
+    }
+
+    /* Out of memory, the next allocation starts a block of the default size */
+    ctx->arena = malloc(XTASK_ARENA_HEADER_SIZE + bytes);
+    if ( ctx->arena )
+    {
+        ctx->arena->next = NULL;
+        ctx->arena->size = bytes;
+        ctx->arena->used = 0;
+    }
+
+#endif
+}
+
+/**
+  * @brief Releases the arena of an ending task.
+  * @retval None.
+  */
+
+static void vTaskArenaRelease(XTask_CtxTypeDef *ctx)
+{
+    XTask_ArenaTypeDef *block, *next;
+
+    for ( block = ctx->arena; block; block = next )
+    {
+        next = block->next;
+        free(block);
+    }
+
+    ctx->arena = NULL;
+}
+
+/**
+  * @brief Moves the tasks arrays off the slots of a static task table, which can then be created
+  *        again, on this instance or another one.
+  * @param capacity: slots to allocate, 0 when no task is left.
+  * @retval false when there was no memory for the slots, they are left in place.
+  */
+
+static bool xTaskLeaveStaticSlots(uint32_t capacity)
+{
+    XTask_HotTypeDef * hot   = NULL;
+    XTask_CtxTypeDef **tasks = NULL;
+
+    if ( capacity > 0 )
+    {
+        hot   = malloc(capacity * sizeof(XTask_HotTypeDef));
+        tasks = malloc(capacity * sizeof(XTask_CtxTypeDef *));
+
+        if ( hot == NULL || tasks == NULL )
+        {
+            free(hot);
+            free(tasks);
+            return false;
+        }
+
+        memcpy(hot, gXTsk->hot, gXTsk->count * sizeof(XTask_HotTypeDef));
+        memcpy(tasks, gXTsk->tasks, gXTsk->count * sizeof(XTask_CtxTypeDef *));
+    }
+
+    /* Cleared slots tell xTaskCreateStatic() that no instance uses them any more */
+    memset(gXTsk->static_table->tasks, 0, gXTsk->static_table->count * sizeof(void *));
+
+    gXTsk->hot          = hot;
+    gXTsk->tasks        = tasks;
+    gXTsk->capacity     = capacity;
+    gXTsk->static_table = NULL;
+
+    return true;
+}
+
+/**
+  * @brief Grows the tasks arrays, doubling their size, until they hold 'needed' slots.
+  * @retval false when there was no memory to grow the arrays.
+  */
+
+static bool xTaskReserveSlots(uint32_t needed)
+{
+    XTask_HotTypeDef * hot;
+    XTask_CtxTypeDef **tasks;
+    uint32_t           capacity = gXTsk->capacity ? gXTsk->capacity : XTASK_INITIAL_SLOTS;
+
+    if ( needed <= gXTsk->capacity )
+        return true;
+
+    while ( capacity < needed )
+        capacity *= 2;
+
+    /* The slots of a static task table cannot grow, move over to allocated ones */
+    if ( gXTsk->static_table )
+        return xTaskLeaveStaticSlots(capacity);
+
+    hot = realloc(gXTsk->hot, capacity * sizeof(XTask_HotTypeDef));
+    if ( hot == NULL )
+        return false;
+
+    gXTsk->hot = hot;
+
+    tasks = realloc(gXTsk->tasks, capacity * sizeof(XTask_CtxTypeDef *));
+    if ( tasks == NULL )
+        return false;
+
+    gXTsk->tasks    = tasks;
+    gXTsk->capacity = capacity;
+
+    return true;
+}
+
+/**
+  * @brief Appends a task to the tasks arrays and initializes its scheduling state.
+  * @retval false when there was no memory to grow the arrays.
+  */
+
+static bool vTaskAttach(XTask_CtxTypeDef *ctx)
+{
+    if ( xTaskReserveSlots(gXTsk->count + 1) == false )
+        return false;
+
+    ctx->slot               = gXTsk->count++;
+    gXTsk->tasks[ctx->slot] = ctx;
+
+    memset(&XTASK_HOT(ctx), 0, sizeof(XTask_HotTypeDef));
+    XTASK_HOT(ctx).event_expire_end = HAL_XTASK_MAX_TIME;
+    XTASK_HOT(ctx).running          = true;
+    gXTsk->wakes++;
+
+    return true;
+}
+
+/**
+  * @brief Releases the slots of the tasks which ended, keeping the others in order.
+  * @retval None.
+  */
+
+static void vTaskCompact(void)
+{
+    uint32_t i, slot = 0;
+
+    if ( gXTsk->released == 0 )
+        return;
+
+    for ( i = 0; i < gXTsk->count; i++ )
+    {
+        if ( gXTsk->tasks[i] == NULL )
+            continue;
+
+        if ( slot != i )
+        {
+            gXTsk->tasks[slot]       = gXTsk->tasks[i];
+            gXTsk->hot[slot]         = gXTsk->hot[i];
+            gXTsk->tasks[slot]->slot = slot;
+        }
+
+        slot++;
+    }
+
+    gXTsk->count    = slot;
+    gXTsk->released = 0;
+
+    /* Once the tasks of a static table ended its slots are given back, the others move off them */
+    if ( gXTsk->static_table )
+    {
+        for ( i = 0; i < gXTsk->static_table->count; i++ )
+            if ( ((XTask_CtxTypeDef *) gXTsk->static_table->entries[i].ctx)->mem_marker == HAL_XTASK_MEM_MARKER )
+                return;
+
+        xTaskLeaveStaticSlots(gXTsk->count ? HAL_MAX(gXTsk->count, XTASK_INITIAL_SLOTS) : 0);
+    }
+}
+
+/**
+  * @brief Create a new task in memory in suspended state.
+  * @param name: NULL terminated string describing the task.
+  * @param cb: Task handler function`.
+  * @param stackSize: Stack to allocate for the stack.
+  * @retval valid handle to the newly created task.
+  */
+
+TaskHandle_t xTaskCreate(char *name, TaskFunction_t cb, uint32_t stackSize, void *ptr)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx       = NULL;
+    static char       stk_color = 'A';
+
+    ctx = malloc(sizeof(XTask_CtxTypeDef));
+    if ( ! ctx )
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task node */
+
+    /* Clears task list member */
+    memset(ctx, 0, sizeof(XTask_CtxTypeDef));
+
+    /* Initializes all of the task properties */
+    strncpy((char *) ctx->name, name, HAL_XTASK_MAX_STRING_SIZE);
+    ctx->mem_marker       = HAL_XTASK_MEM_MARKER;
+    ctx->cb               = cb;
+    ctx->args             = ptr;
+    ctx->sp_bottom        = (char *) malloc(stackSize + 1024);
+    ctx->sp_top           = ctx->sp_bottom + stackSize;
+    ctx->stak_size        = stackSize;
+    ctx->stk_color        = stk_color++;
+
+    if ( ctx->sp_bottom == NULL )
+    {
+        free(ctx);
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task stack */
+    }
+
+    memset(ctx->sp_bottom, ctx->stk_color, ctx->stak_size);
+
+    /* Attach it to the tasks list, tasks created by a running task will be started on the next pass */
+    if ( vTaskAttach(ctx) == false )
+    {
+        free(ctx->sp_bottom);
+        free(ctx);
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task slot */
+    }
+
+    // printf_c(Color_White, "'%s' created, stack bottpm: %p, top : %p", ctx->name, ctx->sp_bottom, ctx->sp_top);
+
+    return (TaskHandle_t) ctx;
+
+#endif
+    return HAL_XTASK_INVALID_HANDLE;
+}
+
+/**
+  * @brief Create a new task running on the shared execution stack.
+  *        Only the portion of the stack in use is copied out to a private buffer when another
+  *        shared stack task needs the stack, so a task parked on a shallow call chain costs a few
+  *        hundred bytes instead of a full stack, at the price of a copy when switching between them.
+  *        Pointers to locals must not be passed to other tasks, the stack moves while parked.
+  * @param name: NULL terminated string describing the task.
+  * @param cb: Task handler function.
+  * @param ptr: Task argument.
+  * @retval valid handle to the newly created task.
+  */
+
+TaskHandle_t xTaskCreateShared(char *name, TaskFunction_t cb, void *ptr)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = NULL;
+
+    /* The shared stack is allocated along with the first task using it */
+    if ( gXTsk->shared_stack == NULL )
+    {
+        gXTsk->shared_stack = (char *) malloc(HAL_XTASK_SHARED_STACK_SIZE + 1024);
+        if ( gXTsk->shared_stack == NULL )
+            return HAL_XTASK_INVALID_HANDLE; /* No memory for the shared stack */
+
+        memset(gXTsk->shared_stack, 'S', HAL_XTASK_SHARED_STACK_SIZE);
+    }
+
+    ctx = malloc(sizeof(XTask_CtxTypeDef));
+    if ( ! ctx )
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task node */
+
+    memset(ctx, 0, sizeof(XTask_CtxTypeDef));
+
+    strncpy((char *) ctx->name, name, HAL_XTASK_MAX_STRING_SIZE);
+    ctx->mem_marker       = HAL_XTASK_MEM_MARKER;
+    ctx->cb               = cb;
+    ctx->args             = ptr;
+    ctx->sp_bottom        = gXTsk->shared_stack;
+    ctx->sp_top           = ctx->sp_bottom + HAL_XTASK_SHARED_STACK_SIZE;
+    ctx->stak_size        = HAL_XTASK_SHARED_STACK_SIZE;
+    ctx->stk_color        = 'S';
+    ctx->shared           = true;
+
+    if ( vTaskAttach(ctx) == false )
+    {
+        free(ctx);
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task slot */
+    }
+
+    return (TaskHandle_t) ctx;
+
+#endif
+    return HAL_XTASK_INVALID_HANDLE;
+}
+
+/**
+  * @brief Creates the tasks of a static task table, see XTASK_STATIC_TABLE(), in the table order.
+  *        Their contexts and stacks are the ones reserved by the table, and so are the scheduler
+  *        slots when the scheduler has no tasks yet: nothing is allocated. The stacks are used as
+  *        the zero filled .bss they are, zero being their stack usage 'color'.
+  *        A table may be created again once all of its tasks ended, the stack usage then reports
+  *        the deepest use of all runs.
+  * @param table: Table defined with XTASK_STATIC_TABLE().
+  * @retval false when a task of the table is still alive, its slots still serve another task or
+  *         there was no memory for them. Nothing is created then.
+  */
+
+bool xTaskCreateStatic(const XTask_StaticTableTypeDef *table)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    const XTask_StaticTypeDef *entry;
+    XTask_CtxTypeDef *         ctx;
+    uint32_t                   i;
+
+    if ( table == NULL )
+        return false;
+
+    for ( i = 0; i < table->count; i++ )
+    {
+        if ( ((XTask_CtxTypeDef *) table->entries[i].ctx)->mem_marker == HAL_XTASK_MEM_MARKER )
+            return false; /* Created already and still alive */
+    }
+
+    /* Other tasks still use the table slots, see xTaskLeaveStaticSlots() */
+    if ( table->count > 0 && table->tasks[0] != NULL )
+        return false;
+
+    /* The dispatcher scans the table slots in place, until more tasks are created than they hold.
+     * Otherwise all the slots are reserved first, the table is created whole or not at all.
+     */
+    if ( gXTsk->capacity == 0 )
+    {
+        gXTsk->hot          = (XTask_HotTypeDef *) table->hot;
+        gXTsk->tasks        = (XTask_CtxTypeDef **) table->tasks;
+        gXTsk->capacity     = table->count;
+        gXTsk->static_table = table;
+    }
+    else if ( xTaskReserveSlots(gXTsk->count + table->count) == false )
+        return false; /* No memory for the task slots */
+
+    for ( i = 0; i < table->count; i++ )
+    {
+        entry = &table->entries[i];
+        ctx   = (XTask_CtxTypeDef *) entry->ctx;
+
+        memset(ctx, 0, sizeof(XTask_CtxTypeDef));
+
+        strncpy((char *) ctx->name, entry->name, HAL_XTASK_MAX_STRING_SIZE);
+        ctx->mem_marker   = HAL_XTASK_MEM_MARKER;
+        ctx->cb           = entry->cb;
+        ctx->args         = entry->args;
+        ctx->sp_bottom    = entry->stack;
+        ctx->sp_top       = ctx->sp_bottom + entry->stackSize;
+        ctx->stak_size    = entry->stackSize;
+        ctx->stk_color    = 0;
+        ctx->static_alloc = true;
+
+        vTaskAttach(ctx); /* Cannot fail, the slots are reserved */
+    }
+
+    return true;
+
+#endif
+    return false;
+}
+
+/**
+  * @brief Create a new stackless task, a resumable function written with the stackless.h macros.
+  *        The task runs on the scheduler stack and returns to it each time it blocks, so it costs
+  *        a few tens of bytes rather than a stack and a couple of jump buffers.
+  * @param cb: Task function, invoked on each turn until it returns XTaskPt_Ended.
+  * @param ptr: Task argument.
+  * @retval valid handle to the newly created task.
+  */
+
+TaskHandle_t xTaskCreateStackless(StacklessFunction_t cb, void *ptr)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = NULL;
+
+    if ( cb == NULL )
+        return HAL_XTASK_INVALID_HANDLE;
+
+    /* Only the members shared by all tasks are allocated */
+    ctx = malloc(XTASK_STACKLESS_CTX_SIZE);
+    if ( ! ctx )
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task node */
+
+    memset(ctx, 0, XTASK_STACKLESS_CTX_SIZE);
+
+    ctx->mem_marker = HAL_XTASK_MEM_MARKER;
+    ctx->cb         = (TaskFunction_t) cb;
+    ctx->args       = ptr;
+    ctx->stackless  = true;
+
+    if ( vTaskAttach(ctx) == false )
+    {
+        free(ctx);
+        return HAL_XTASK_INVALID_HANDLE; /* No memory for the task slot */
+    }
+
+    return (TaskHandle_t) ctx;
+
+#endif
+    return HAL_XTASK_INVALID_HANDLE;
+}
+
+/**
+  * @brie Gets the task handle by iterating the tasks list.
+  * @retval task pointer if found, else NULL.
+  */
+
+TaskHandle_t xTaskGetHandle(void)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    /* If the context is valid */
+    if ( ctx )
+        return (TaskHandle_t) ctx;
+
+#endif
+    return HAL_XTASK_INVALID_HANDLE;
+}
+
+/**
+  * @brief Gets the earliest tick at which a blocked task becomes ready or a timer expires.
+  * @retval Tick value, HAL_XTASK_MAX_TIME when nothing is waiting for a deadline.
+  */
+
+static uint32_t xTaskGetNextDeadline(void)
+{
+    XTask_CtxTypeDef *ctx      = NULL;
+    uint32_t          deadline = xTimerGetNextExpiry();
+    uint32_t          i;
+
+    XTASK_FOREACH(i, ctx)
+    {
+        if ( XTASK_HOT(ctx).running == false )
+            continue;
+
+        if ( XTASK_HOT(ctx).delay_end > 0 )
+            deadline = HAL_MIN(deadline, XTASK_HOT(ctx).delay_end);
+        else if ( XTASK_HOT(ctx).pendingEvent == true )
+            deadline = HAL_MIN(deadline, XTASK_HOT(ctx).event_expire_end);
+    }
+
+    return deadline;
+}
+
+/**
+  * @brief Terminates the scheduler, may be called from within a task.
+  *        All tasks are released and vTaskStartScheduler() returns to its caller.
+  * @retval None.
+  */
+
+void vTaskEndScheduler(void)
+{
+#if ( HAL_XTASK_ENABLED > 0 )
+
+    XTask_CtxTypeDef *ctx = xTaskGetContext(); /* Find current context */
+
+    gXTsk->stop = true;
+
+    /* Called from a task, jump back to the scheduler so it could wind down */
+    if ( ctx && XTASK_HOT(ctx).running == true )
+    {
+        XTASK_HOT(ctx).yielding = true;
+        vTaskJump(ctx);
+    }
 
-    /* Start all tasks, the next task will be started as soon as the previous one yields */
-    /* This is an intermediate state, where have to invoke the task by calling it startup routine.
+#endif
+}
+
+/**
+  * @brief Releases a task context and its stack if it has one.
+  * @retval None.
+  */
+
+static void vTaskFree(XTask_CtxTypeDef *ctx)
+{
+    ctx->mem_marker = 0; /* Invalidate stale handles */
+
+    /* Its slot is reclaimed by the next compaction */
+    memset(&XTASK_HOT(ctx), 0, sizeof(XTask_HotTypeDef));
+    gXTsk->tasks[ctx->slot] = NULL;
+    gXTsk->released++;
+
+    vTaskArenaRelease(ctx);
+    free(ctx->mailbox);
+
+    /* Static tasks own nothing else, stackless contexts end before the stack members */
+    if ( ctx->static_alloc )
+        return;
+    else if ( ctx->stackless )
+        ;
+    else if ( ctx->shared )
+    {
+        /* The shared stack itself is released along with the scheduler */
+        if ( gXTsk->shared_owner == ctx )
+            gXTsk->shared_owner = NULL;
+
+        free(ctx->save_buf);
+    }
+    else
+        free(ctx->sp_bottom);
+
+    free(ctx);
+}
+
+/**
+  * @brief Outermost frame of every stackful task, runs the task on its own stack.
+  * @retval Nothing
+  */
+
+static void vTaskEntry(void)
+{
+    gXTsk->cur->cb(gXTsk->cur->args);
+
+    /* The task returned, there is no frame to return to on this stack, mark it
+     * as done and jump back to the scheduler which will release it.
      */
-    LL_FOREACH(gXTsk.head, gXTsk.cur)
+    XTASK_HOT(gXTsk->cur).running = false;
+    longjmp(gXTsk->cur->ctx_sched, 1);
+}
+
+/**
+  * @brief Enters the task for the first time.
+  * @retval Nothing
+  */
+
+void vTaskStart(XTask_CtxTypeDef *ctx)
+{
+
+    /*
+    * This task has not been started yet. Assign a new stack pointer and enter the task
+    * through a terminated frame: a null return address and a null caller frame pointer,
+    * so debuggers and stack walkers stop at the task entry rather than wander off.
+	*/
+    register void *top = (void *) ctx->sp_top;
+    __asm
+    {
+			mov esp, top;
+			push 0;
+			xor ebp, ebp;
+			jmp vTaskEntry;
+    }
+}
+
+/**
+  * @brief Hands the shared stack over to a task: the stack of the task occupying it is saved
+  *        and the stack of the incoming task, if it was started already, is restored.
+  *        Nothing is copied while the same task keeps running.
+  * @retval false when there was no memory to save the outgoing task stack.
+  */
+
+static bool xTaskClaimSharedStack(XTask_CtxTypeDef *ctx)
+{
+    XTask_CtxTypeDef *owner = gXTsk->shared_owner;
+    uint32_t          size;
+    char *            buf;
+
+    if ( owner == ctx )
+        return true;
+
+    if ( owner )
     {
-        if ( gXTsk.cur->mem_marker == HAL_XTASK_MEM_MARKER )
+        /* Copy out the used portion only, right sizing the buffer when it has to grow */
+        size = (uint32_t) (owner->sp_top - HAL_MAX(owner->sp_saved, owner->sp_bottom));
+
+        if ( size > owner->save_cap )
         {
+            buf = realloc(owner->save_buf, size);
+            if ( buf == NULL )
+                return false;
 
-            gXTsk.cur->running = true;
-            if ( ! setjmp(gXTsk.cur->ctx_sched) )
-            {
-                vTaskStart(gXTsk.cur);
-            }
+            owner->save_buf = buf;
+            owner->save_cap = size;
         }
+
+        memcpy(owner->save_buf, owner->sp_top - size, size);
+        owner->save_size = size;
     }
 
-    /* Sets scheduler state to running */
-    gXTsk.running = true;
+    if ( XTASK_HOT(ctx).started )
+        memcpy(ctx->sp_top - ctx->save_size, ctx->save_buf, ctx->save_size);
+
+    gXTsk->shared_owner = ctx;
+    return true;
+}
+
+/**
+  * @brief Switches to a stackful task, on its first turn its startup routine is invoked on its own stack.
+  * @retval None.
+  */
+
+static void vTaskRun(XTask_CtxTypeDef *ctx)
+{
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+    uint32_t ticks_spent;
+#endif
+
+    /* Out of memory for saving the shared stack, retry on the next pass */
+    if ( ctx->shared && xTaskClaimSharedStack(ctx) == false )
+        return;
 
-    /* Infinite loop serving tasks as needed */
-    while ( true )
+    XTASK_HOT(ctx).delay_end = 0;
+    XTASK_HOT(ctx).yielding  = false;
+    ctx->ticks_start         = HAL_GetTick();
+
+    if ( XTASK_HOT(ctx).started == false )
+    {
+        XTASK_HOT(ctx).started = true;
+
+        if ( ! setjmp(ctx->ctx_sched) )
+            vTaskStart(ctx);
+    }
+    else
+    {
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+        ctx->switches++;
+        xTaskRecordLatency(ctx, (ctx->ticks_start > ctx->ready_tick) ? (ctx->ticks_start - ctx->ready_tick) : 0);
+#endif
+
+        vSchedJump(ctx);
+    }
+
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+
+    /* Collect statistics */
+    ticks_spent     = (HAL_GetTick() - ctx->ticks_start);
+    ctx->ticks_peek = HAL_MAX(ctx->ticks_peek, ticks_spent);
+    ctx->ticks_accumulated += ticks_spent; /* Store total accumulated ticks spent by the task */
+#endif
+}
+
+/**
+  * @brief Invokes a stackless task on the scheduler stack, it returns once it blocks.
+  * @retval None.
+  */
+
+static void vTaskRunStackless(XTask_CtxTypeDef *ctx)
+{
+    XTASK_HOT(ctx).delay_end = 0;
+    XTASK_HOT(ctx).yielding  = false;
+    XTASK_HOT(ctx).started   = true;
+
+    if ( ((StacklessFunction_t) ctx->cb)(&ctx->pt, ctx->args) == XTaskPt_Ended )
+        XTASK_HOT(ctx).running = false;
+
+    /* Returned without blocking, resume it on the next pass as if it yielded */
+    else if ( XTASK_HOT(ctx).yielding == false && XTASK_HOT(ctx).pendingEvent == false )
+        XTASK_HOT(ctx).yielding = true;
+}
+
+/**
+  * @brief Releases the tasks, timers and memory of the selected scheduler instance.
+  * @retval None.
+  */
+
+static void vSchedulerRelease(void)
+{
+    XTask_CtxTypeDef *   ctx = NULL;
+    XTask_FutureTypeDef *future;
+    XWork_ItemTypeDef *  item, *next;
+    uint32_t             i;
+
+    /* The worker threads must be done with the offloaded calls before their tasks go away */
+    while ( gXTsk->work.inflight > 0 )
+        Sleep(1);
+
+    for ( item = xWorkCollect(&gXTsk->work); item; item = next )
+    {
+        next = item->next;
+        free(item);
+    }
+
+    /* The children of pending futures go away with the call unfinished, so do their waiters */
+    XTASK_FOREACH(i, ctx)
+    {
+        future = (ctx->cb == vTaskFutureEntry) ? (XTask_FutureTypeDef *) ctx->args : NULL;
+        if ( future == NULL || future->done )
+            continue;
+
+        if ( future->released )
+        {
+            future->mem_marker = 0;
+            free(future);
+        }
+        else
+        {
+            future->failed = true;
+            future->waiter = NULL;
+        }
+    }
+
+    /* The group waiters are released as well, the groups only lose their tasks */
+    XTASK_FOREACH(i, ctx)
+    {
+        if ( ctx->group )
+        {
+            ctx->group->waiter = NULL;
+            vTaskGroupLeave(ctx);
+        }
+    }
+
+    XTASK_FOREACH(i, ctx)
+        vTaskFree(ctx);
+
+    vTimerDeleteAll();
+
+    free(gXTsk->shared_stack);
+    gXTsk->shared_stack = NULL;
+    gXTsk->shared_owner = NULL;
+
+    if ( gXTsk->static_table )
+        xTaskLeaveStaticSlots(0);
+    else
     {
+        free(gXTsk->hot);
+        free(gXTsk->tasks);
+    }
+
+    gXTsk->hot      = NULL;
+    gXTsk->tasks    = NULL;
+    gXTsk->count    = 0;
+    gXTsk->capacity = 0;
+    gXTsk->released = 0;
+}
+
+/**
+  * @brief Start an endless task scheduler loop.
+  * @retval HAL Status type.
+  */
+
+bool vTaskStartScheduler(void)
+{
+    XTask_CtxTypeDef *ctx  = NULL;
+    bool              idle = true;
+    uint32_t          now;
+    uint32_t          i;
+    uint32_t          deadline;
+
+    /* Already running ? */
+    if ( gXTsk->running == true )
+        return false;
+
+    /* No tasks to execute nor timers to serve! */
+    if ( gXTsk->count == 0 && xTimerGetNextExpiry() == HAL_XTASK_MAX_TIME )
+        return false;
+
+    /* Useful, allow some time for the system to stabilize before starting the show */
+    HAL_Delay(100);
+
+    /* Default time slice, the cycle counter frequency is measured on first use */
+    if ( gXTsk->slice_cycles == 0 )
+        vTaskSetTimeSlice(HAL_XTASK_TIME_SLICE_US);
+
+    /* Sets scheduler state to running */
+    gXTsk->running = true;
+
+#if ( XTASK_MONITOR > 0 )
+
+    /* Preemption, watchdog or profiler requested before the start */
+    vTaskMonitorUpdate();
+#endif
 
-        LL_FOREACH(gXTsk.head, gXTsk.cur)
+    /* Loop serving tasks and timers as needed until the scheduler is ended or nothing is left to serve */
+    while ( gXTsk->stop == false && (gXTsk->count > 0 || xTimerGetNextExpiry() != HAL_XTASK_MAX_TIME) )
+    {
+        /* Expired timers call backs are invoked first, they may signal tasks which then run in this pass */
+        idle = (xTimerProcess() == 0);
+        idle = (xTaskProcessCompletions() == 0) && idle;
+        now  = HAL_GetTick();
+
+        /* Tasks are served in the order of their creation, each started on its first turn.
+         * Only the hot records are scanned, a task context is touched once it is found ready.
+         * Tasks created meanwhile are appended and served within the same pass.
+         */
+        for ( i = 0; i < gXTsk->count && gXTsk->stop == false; i++ )
         {
+            if ( xTaskIsReady(&gXTsk->hot[i], now) == false )
+                continue;
+
+            gXTsk->cur = ctx = gXTsk->tasks[i];
 
 #if ( HAL_XTASK_STACK_CHECK_LEN > 0 )
 
-            if ( xTaskValidate(gXTsk.cur) == false )
+            if ( xTaskValidate(ctx) == false )
             {
                 printf("\r\nStack over flow detected!\r\n");
                 exit(0); /* Invalid handle or stack memory, not really a heap is */
@@ -525,39 +3352,244 @@ bool vTaskStartScheduler(void)
              * jump from one context to the next without passing through here.
              */
 
-            gXTsk.cur->ticks_start = 0;
+            idle               = false;
+            gXTsk->slice_start = HAL_GetCycles();
+            gXTsk->quiet_until = 0;
 
-            /* Check if event expiration tick was set and reached */
-            if ( gXTsk.cur->running == true && (gXTsk.cur->yielding == true || gXTsk.cur->events || (HAL_GetTick() >= gXTsk.cur->event_expire_end)) )
-            {
+#if ( HAL_XTASK_PREEMPTION > 0 )
+            gXTsk->preempt = 0;
+#endif
 
-                /* Check if delay interval was set and expired */
-                if ( gXTsk.cur->delay_end == 0 || gXTsk.cur->delay_end <= HAL_GetTick() )
-                {
-                    gXTsk.cur->delay_end   = 0;
-                    gXTsk.cur->yielding    = false;
-                    gXTsk.cur->ticks_start = HAL_GetTick();
+#if ( HAL_XTASK_WATCHDOG > 0 )
+            /* The monitor thread reads the budget of the turn here, the context may be gone by then */
+            gXTsk->turn_start  = HAL_GetTick();
+            gXTsk->turn_budget = ctx->stackless ? 0 : (ctx->budget ? ctx->budget : gXTsk->wd_budget);
+#endif
 
-                    vSchedJump(gXTsk.cur);
-                }
-            }
+#if ( XTASK_MONITOR > 0 )
+            gXTsk->dispatches++; /* Odd while a task runs */
+#endif
 
-#if ( HAL_XTASK_COLLECT_STATS > 0 )
+            if ( ctx->stackless )
+                vTaskRunStackless(ctx);
+            else
+                vTaskRun(ctx);
 
-            /* Collect statistics */
-            if ( gXTsk.cur->ticks_start > 0 )
-            {
-                ticks_spent           = (HAL_GetTick() - gXTsk.cur->ticks_start);
-                gXTsk.cur->ticks_peek = HAL_MAX(gXTsk.cur->ticks_peek, ticks_spent);
-                gXTsk.cur->ticks_accumulated += ticks_spent; /* Store total accumulated ticks spent by the task */
-            }
+#if ( XTASK_MONITOR > 0 )
+            gXTsk->dispatches++;
 #endif
-            /* Dump statitics when the user presses any key */
-            if ( HAL_getch() > -1 )
+
+            gXTsk->cur = NULL;
+            now        = HAL_GetTick();
+
+#if ( HAL_XTASK_WATCHDOG > 0 )
+            if ( ! ctx->stackless )
+                vTaskWatchdogCheck(ctx);
+#endif
+
+            /* The task has returned, release it */
+            if ( XTASK_HOT(ctx).running == false )
             {
-                xTaskDumpStats(printf);
-                HAL_Pause("\r\nPress space to continue..\r\n", 0x20);
+                if ( ctx->group )
+                    vTaskGroupLeave(ctx);
+
+                vTaskFree(ctx);
             }
         }
+
+        /* Reclaim the slots of the tasks that ended */
+        vTaskCompact();
+
+        /* Dump statitics when the user presses any key */
+        if ( HAL_getch() > -1 )
+        {
+            xTaskDumpStats(printf);
+            HAL_Pause("\r\nPress space to continue..\r\n", 0x20);
+        }
+
+        /* Virtual time, no task could run during the whole pass so jump straight to the
+         * next deadline. When there is none nothing could ever wake up, end the scheduler.
+         */
+        /* Offloaded calls take no virtual time, wait for them and their completions rather than
+         * moving the clock. A worker queues the completion before dropping the in-flight count.
+         */
+        if ( idle == true && HAL_IsVirtualTime() == true && gXTsk->work.inflight == 0 && gXTsk->work.head == NULL )
+        {
+            deadline = xTaskGetNextDeadline();
+
+            if ( deadline == HAL_XTASK_MAX_TIME )
+                gXTsk->stop = true;
+            else
+                HAL_AdvanceTicks(deadline);
+        }
+
+#if ( HAL_XTASK_COLLECT_STATS > 0 )
+
+        /* Periodic machine readable statistics export */
+        vTaskExportIfDue();
+#endif
+    }
+
+#if ( XTASK_MONITOR > 0 )
+    vTaskMonitorStop();
+#endif
+
+    /* The scheduler was ended, release whatever is left */
+    vSchedulerRelease();
+
+    gXTsk->cur     = NULL;
+    gXTsk->stop    = false;
+    gXTsk->running = false;
+
+    return true;
+}
+
+/**
+  * @brief Validates a scheduler instance handle.
+  * @retval instance pointer if valid, else NULL.
+  */
+
+static XTask_ConfigTypeDef *xSchedulerGetContext(SchedulerHandle_t handle)
+{
+    XTask_ConfigTypeDef *sched = (XTask_ConfigTypeDef *) handle;
+
+    if ( sched && handle != HAL_XSCHED_INVALID_HANDLE && sched->mem_marker == HAL_XSCHED_MEM_MARKER )
+        return sched;
+
+    return NULL;
+}
+
+/**
+  * @brief Creates a new scheduler instance, with no tasks nor timers.
+  *        Instances share nothing, each one is meant to be run by its own thread.
+  * @retval valid handle to the newly created instance.
+  */
+
+SchedulerHandle_t xSchedulerCreate(void)
+{
+    XTask_ConfigTypeDef *sched = malloc(sizeof(XTask_ConfigTypeDef));
+
+    if ( ! sched )
+        return HAL_XSCHED_INVALID_HANDLE; /* No memory for the instance */
+
+    memset(sched, 0, sizeof(XTask_ConfigTypeDef));
+    sched->mem_marker = HAL_XSCHED_MEM_MARKER;
+
+    return (SchedulerHandle_t) sched;
+}
+
+/**
+  * @brief Selects the scheduler instance the calling thread works with: the tasks and timers
+  *        it creates are added to that instance and vTaskStartScheduler() runs it.
+  *        Threads start with the default instance selected.
+  * @retval handle to the previously selected instance, HAL_XSCHED_INVALID_HANDLE when
+  *         'handle' is invalid, the selection is then left unchanged.
+  */
+
+SchedulerHandle_t xSchedulerSelect(SchedulerHandle_t handle)
+{
+    XTask_ConfigTypeDef *sched = xSchedulerGetContext(handle);
+    XTask_ConfigTypeDef *prev  = gXTsk;
+
+    if ( sched == NULL )
+        return HAL_XSCHED_INVALID_HANDLE;
+
+    gXTsk = sched;
+    return (SchedulerHandle_t) prev;
+}
+
+/**
+  * @brief Gets the scheduler instance selected by the calling thread.
+  * @retval Instance handle.
+  */
+
+SchedulerHandle_t xSchedulerGetCurrent(void)
+{
+    return (SchedulerHandle_t) gXTsk;
+}
+
+/**
+  * @brief Runs a scheduler instance in the calling thread until it ends, the thread
+  *        selection is restored on return. Cannot be called from within a task.
+  * @retval false when the instance was invalid, already running or had nothing to serve.
+  */
+
+bool vSchedulerRun(SchedulerHandle_t handle)
+{
+    SchedulerHandle_t prev;
+    bool              ret;
+
+    if ( gXTsk->running == true )
+        return false;
+
+    prev = xSchedulerSelect(handle);
+    if ( prev == HAL_XSCHED_INVALID_HANDLE )
+        return false;
+
+    ret = vTaskStartScheduler();
+    xSchedulerSelect(prev);
+
+    return ret;
+}
+
+/**
+  * @brief Releases a scheduler instance along with the tasks and timers it still holds.
+  *        The default, running or selected instances cannot be deleted.
+  * @retval Boolean.
+  */
+
+bool vSchedulerDelete(SchedulerHandle_t handle)
+{
+    XTask_ConfigTypeDef *sched = xSchedulerGetContext(handle);
+    SchedulerHandle_t    prev;
+
+    if ( sched == NULL || sched == &gXTskDefault || sched == gXTsk || sched->running == true )
+        return false;
+
+    prev = xSchedulerSelect(handle);
+    vSchedulerRelease();
+    xSchedulerSelect(prev);
+
+#if ( HAL_XTASK_PROFILER > 0 )
+    if ( sched->prof_samples )
+    {
+        DeleteCriticalSection(&sched->prof_lock);
+        free(sched->prof_samples);
     }
+#endif
+
+    sched->mem_marker = 0; /* Invalidate stale handles */
+    free(sched);
+
+    return true;
+}
+
+/**
+  * @brief Creates a task in a given scheduler instance, see xTaskCreate().
+  *        Must not be used while the instance is run by another thread.
+  * @retval valid handle to the newly created task.
+  */
+
+TaskHandle_t xTaskCreateOn(SchedulerHandle_t sched, char *name, TaskFunction_t cb, uint32_t stackSize, void *ptr)
+{
+    SchedulerHandle_t prev = xSchedulerSelect(sched);
+    TaskHandle_t      handle;
+
+    if ( prev == HAL_XSCHED_INVALID_HANDLE )
+        return HAL_XTASK_INVALID_HANDLE;
+
+    handle = xTaskCreate(name, cb, stackSize, ptr);
+    xSchedulerSelect(prev);
+
+    return handle;
+}
+
+/**
+  * @brief Gets the timers list of the selected scheduler instance, for the timers module.
+  * @retval Pointer to the list head.
+  */
+
+void **xSchedulerGetTimers(void)
+{
+    return &gXTsk->timers;
 }
@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    timers.c
+  * @brief   Software timers module driver.
+  *
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+  * All rights reserved.</center></h2>
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include "timers.h"
+#include "hal.h"
+#include "llist.h"
+#include "scheduler.h"
+
+/* Memory protection value */
+#define HAL_XTIMER_MEM_MARKER 0xcca77acc
+
+/**
+  * @brief Descriptor associated with each timer.
+  */
+
+typedef struct __XTimer_CtxTypeDef
+{
+    TimerCallbackFunction_t     cb;         /* Expiration call back */
+    void *                      args;       /* Call back arguments */
+    const char *                name;       /* Timer name, not copied */
+    uint32_t                    period;     /* Period in ticks */
+    uint32_t                    expire;     /* Expiration tick, HAL_XTASK_MAX_TIME when not active */
+    uint8_t                     autoReload; /* Restart once expired? */
+    uint8_t                     active;     /* Is the timer running? */
+    uint32_t                    mem_marker; /* Memory protection marker */
+    struct __XTimer_CtxTypeDef *next;       /* Link next pointer */
+
+} XTimer_CtxTypeDef;
+
+/* All timers of the selected scheduler instance, active ones first in order of expiration */
+#define gXTmrHead (*(XTimer_CtxTypeDef **) xSchedulerGetTimers())
+
+/**
+  * @brief Orders timers by expiration tick, list insertion comparator.
+  */
+
+static int xTimerCompare(XTimer_CtxTypeDef *a, XTimer_CtxTypeDef *b)
+{
+    return (a->expire > b->expire) - (a->expire < b->expire);
+}
+
+/**
+  * @brief Validates a timer handle.
+  * @retval timer pointer if valid, else NULL.
+  */
+
+static XTimer_CtxTypeDef *xTimerGetContext(TimerHandle_t handle)
+{
+    XTimer_CtxTypeDef *tmr = (XTimer_CtxTypeDef *) handle;
+
+    if ( tmr && handle != HAL_XTIMER_INVALID_HANDLE && tmr->mem_marker == HAL_XTIMER_MEM_MARKER )
+        return tmr;
+
+    return NULL;
+}
+
+/**
+  * @brief Places a timer in the list according to its new expiration tick.
+  * @retval None.
+  */
+
+static void vTimerSchedule(XTimer_CtxTypeDef *tmr, uint32_t expire)
+{
+    LL_DELETE(gXTmrHead, tmr);
+
+    tmr->active = (expire != HAL_XTASK_MAX_TIME);
+    tmr->expire = expire;
+
+    LL_INSERT_INORDER(gXTmrHead, tmr, xTimerCompare);
+}
+
+/**
+  * @brief Creates a new timer in stopped state.
+  * @param name: NULL terminated string describing the timer, must remain valid for the timer life time.
+  * @param period: period in ticks.
+  * @param autoReload: restart automatically each time the period expires.
+  * @param cb: Call back invoked from the scheduler loop when the period expires.
+  * @param ptr: Call back argument.
+  * @retval valid handle to the newly created timer.
+  */
+
+TimerHandle_t xTimerCreate(const char *name, uint32_t period, bool autoReload, TimerCallbackFunction_t cb, void *ptr)
+{
+    XTimer_CtxTypeDef *tmr = NULL;
+
+    if ( period == 0 || cb == NULL )
+        return HAL_XTIMER_INVALID_HANDLE;
+
+    tmr = malloc(sizeof(XTimer_CtxTypeDef));
+    if ( ! tmr )
+        return HAL_XTIMER_INVALID_HANDLE; /* No memory for the timer */
+
+    memset(tmr, 0, sizeof(XTimer_CtxTypeDef));
+
+    tmr->mem_marker = HAL_XTIMER_MEM_MARKER;
+    tmr->cb         = cb;
+    tmr->args       = ptr;
+    tmr->name       = name;
+    tmr->period     = period;
+    tmr->autoReload = autoReload;
+    tmr->expire     = HAL_XTASK_MAX_TIME;
+
+    /* Stopped timers are kept at the list tail */
+    LL_INSERT_INORDER(gXTmrHead, tmr, xTimerCompare);
+
+    return (TimerHandle_t) tmr;
+}
+
+/**
+  * @brief Starts a timer, or restarts it with a full period when already active.
+  * @retval Boolean.
+  */
+
+bool xTimerStart(TimerHandle_t handle)
+{
+    XTimer_CtxTypeDef *tmr = xTimerGetContext(handle);
+
+    if ( tmr == NULL )
+        return false;
+
+    vTimerSchedule(tmr, HAL_GetTick() + tmr->period);
+    return true;
+}
+
+/**
+  * @brief Stops a timer.
+  * @retval Boolean.
+  */
+
+bool xTimerStop(TimerHandle_t handle)
+{
+    XTimer_CtxTypeDef *tmr = xTimerGetContext(handle);
+
+    if ( tmr == NULL )
+        return false;
+
+    vTimerSchedule(tmr, HAL_XTASK_MAX_TIME);
+    return true;
+}
+
+/**
+  * @brief Changes a timer period, an active timer is restarted with the new period.
+  * @retval Boolean.
+  */
+
+bool xTimerChangePeriod(TimerHandle_t handle, uint32_t period)
+{
+    XTimer_CtxTypeDef *tmr = xTimerGetContext(handle);
+
+    if ( tmr == NULL || period == 0 )
+        return false;
+
+    tmr->period = period;
+
+    if ( tmr->active )
+        vTimerSchedule(tmr, HAL_GetTick() + tmr->period);
+
+    return true;
+}
+
+/**
+  * @brief Checks whether a timer is running.
+  * @retval Boolean.
+  */
+
+bool xTimerIsActive(TimerHandle_t handle)
+{
+    XTimer_CtxTypeDef *tmr = xTimerGetContext(handle);
+
+    return (tmr && tmr->active);
+}
+
+/**
+  * @brief Releases a timer, may be called from its own call back.
+  * @retval Boolean.
+  */
+
+bool xTimerDelete(TimerHandle_t handle)
+{
+    XTimer_CtxTypeDef *tmr = xTimerGetContext(handle);
+
+    if ( tmr == NULL )
+        return false;
+
+    LL_DELETE(gXTmrHead, tmr);
+
+    tmr->mem_marker = 0; /* Invalidate stale handles */
+    free(tmr);
+
+    return true;
+}
+
+/**
+  * @brief Releases all timers.
+  * @retval None.
+  */
+
+void vTimerDeleteAll(void)
+{
+    XTimer_CtxTypeDef *tmr, *tmp;
+
+    LL_FOREACH_SAFE(gXTmrHead, tmr, tmp)
+    {
+        tmr->mem_marker = 0;
+        free(tmr);
+    }
+
+    gXTmrHead = NULL;
+}
+
+/**
+  * @brief Gets the earliest expiration tick of the active timers.
+  * @retval Tick value, HAL_XTASK_MAX_TIME when no timer is active.
+  */
+
+uint32_t xTimerGetNextExpiry(void)
+{
+    if ( gXTmrHead && gXTmrHead->active )
+        return gXTmrHead->expire;
+
+    return HAL_XTASK_MAX_TIME;
+}
+
+/**
+  * @brief Invokes the call backs of all expired timers, called by the scheduler loop.
+  * @note  Auto reload timers are rescheduled before their call back runs, one period
+  *        past the previous expiration so they do not drift. Expirations missed
+  *        while the scheduler was busy are skipped.
+  * @retval Count of call backs invoked.
+  */
+
+uint32_t xTimerProcess(void)
+{
+    XTimer_CtxTypeDef *tmr;
+    uint32_t           now   = HAL_GetTick();
+    uint32_t           fired = 0;
+    uint32_t           expire;
+
+    /* Active timers are sorted, only the list head has to be checked */
+    while ( (tmr = gXTmrHead) != NULL && tmr->active && tmr->expire <= now )
+    {
+        if ( tmr->autoReload )
+        {
+            expire = tmr->expire + tmr->period;
+            if ( expire <= now )
+                expire += ((now - expire) / tmr->period + 1) * tmr->period;
+
+            vTimerSchedule(tmr, expire);
+        }
+        else
+            vTimerSchedule(tmr, HAL_XTASK_MAX_TIME);
+
+        /* The call back may stop, restart or delete the timer */
+        tmr->cb((TimerHandle_t) tmr, tmr->args);
+        fired++;
+    }
+
+    return fired;
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
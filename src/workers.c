@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file    workers.c
+  * @brief   Worker threads pool module driver.
+  *
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+  * All rights reserved.</center></h2>
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include "workers.h"
+#include "hal.h"
+
+#include <string.h>
+
+/**
+  * @brief Module locals.
+  */
+
+typedef struct __XWork_ConfigTypeDef
+{
+    CRITICAL_SECTION   lock;    /* Guards the pending list and the completion queues */
+    CONDITION_VARIABLE ready;   /* Signaled when an item is pending */
+    CONDITION_VARIABLE drained; /* Signaled when a completion queue has no item in flight left */
+    XWork_ItemTypeDef *head;    /* Pending items, in the order of submission */
+    XWork_ItemTypeDef *tail;    /* Last pending item */
+    uint32_t           pending; /* Count of pending items */
+    uint32_t           idle;    /* Count of threads waiting for an item */
+    uint32_t           threads; /* Count of threads started */
+    volatile LONG      init;    /* 0: not initialized, 1: being initialized, 2: ready */
+
+} XWork_ConfigTypeDef;
+
+/* Range split over the worker threads by xParallelFor() */
+typedef struct __XWork_RangeTypeDef
+{
+    RangeFunction_t fn;           /* Call processing a sub range */
+    void *          ctx;          /* Call context */
+    volatile LONG   next;         /* First index not claimed yet */
+    uint32_t        end;          /* Range end, excluded */
+    uint32_t        grain;        /* Minimum count of indexes claimed at once */
+    uint32_t        participants; /* Count of threads sharing the range, including the caller */
+
+} XWork_RangeTypeDef;
+
+/* Container for this module globals, shared by all the scheduler instances */
+XWork_ConfigTypeDef gXWrk = {.head = NULL, .tail = NULL, .pending = 0, .idle = 0, .threads = 0, .init = 0};
+
+/**
+  * @brief Initializes the module on first use, from whichever thread gets there first.
+  * @retval None.
+  */
+
+static void vWorkInit(void)
+{
+    if ( gXWrk.init == 2 )
+        return;
+
+    if ( InterlockedCompareExchange(&gXWrk.init, 1, 0) == 0 )
+    {
+        InitializeCriticalSection(&gXWrk.lock);
+        InitializeConditionVariable(&gXWrk.ready);
+        InitializeConditionVariable(&gXWrk.drained);
+        InterlockedExchange(&gXWrk.init, 2);
+    }
+
+    /* Another thread is initializing the module */
+    while ( gXWrk.init != 2 )
+        Sleep(0);
+}
+
+/**
+  * @brief Worker thread, runs the pending items one after the other.
+  * @retval Thread exit code.
+  */
+
+static DWORD WINAPI xWorkThread(LPVOID param)
+{
+    XWork_ItemTypeDef *item;
+
+    while ( 1 )
+    {
+        EnterCriticalSection(&gXWrk.lock);
+
+        while ( gXWrk.head == NULL )
+        {
+            gXWrk.idle++;
+            SleepConditionVariableCS(&gXWrk.ready, &gXWrk.lock, INFINITE);
+            gXWrk.idle--;
+        }
+
+        item       = gXWrk.head;
+        gXWrk.head = item->next;
+        if ( gXWrk.head == NULL )
+            gXWrk.tail = NULL;
+
+        gXWrk.pending--;
+        LeaveCriticalSection(&gXWrk.lock);
+
+        item->result = item->fn(item->arg);
+
+        /* Hand the item back to its submitter */
+        EnterCriticalSection(&gXWrk.lock);
+        item->next       = item->done->head;
+        item->done->head = item;
+
+        if ( InterlockedDecrement(&item->done->inflight) == 0 )
+            WakeAllConditionVariable(&gXWrk.drained);
+
+        LeaveCriticalSection(&gXWrk.lock);
+    }
+
+    return 0;
+}
+
+/**
+  * @brief Queues a call to be run by a worker thread, a thread is started when all
+  *        the running ones are busy and the pool is not full yet.
+  * @param item: call to run, must remain valid until collected.
+  * @param done: queue the item is moved to once the call returned, see xWorkCollect().
+  * @retval false when no worker thread could be started.
+  */
+
+bool xWorkSubmit(XWork_ItemTypeDef *item, XWork_QueueTypeDef *done)
+{
+    HANDLE thread;
+
+    if ( item == NULL || item->fn == NULL || done == NULL )
+        return false;
+
+    vWorkInit();
+
+    item->done = done;
+    item->next = NULL;
+
+    EnterCriticalSection(&gXWrk.lock);
+
+    if ( gXWrk.pending >= gXWrk.idle && gXWrk.threads < HAL_XWORK_MAX_THREADS )
+    {
+        thread = CreateThread(NULL, 0, xWorkThread, NULL, 0, NULL);
+        if ( thread != NULL )
+        {
+            CloseHandle(thread); /* Threads live as long as the process */
+            gXWrk.threads++;
+        }
+    }
+
+    if ( gXWrk.threads == 0 )
+    {
+        LeaveCriticalSection(&gXWrk.lock);
+        return false;
+    }
+
+    if ( gXWrk.tail )
+        gXWrk.tail->next = item;
+    else
+        gXWrk.head = item;
+
+    gXWrk.tail = item;
+    gXWrk.pending++;
+    InterlockedIncrement(&done->inflight);
+
+    WakeConditionVariable(&gXWrk.ready);
+    LeaveCriticalSection(&gXWrk.lock);
+
+    return true;
+}
+
+/**
+  * @brief Takes the completed items out of a queue, cheap when there are none.
+  * @retval Completed items list, NULL when empty.
+  */
+
+XWork_ItemTypeDef *xWorkCollect(XWork_QueueTypeDef *done)
+{
+    XWork_ItemTypeDef *items;
+
+    if ( done->head == NULL )
+        return NULL;
+
+    EnterCriticalSection(&gXWrk.lock);
+    items      = done->head;
+    done->head = NULL;
+    LeaveCriticalSection(&gXWrk.lock);
+
+    return items;
+}
+
+/**
+  * @brief Withdraws an item no worker thread has taken yet.
+  * @retval false when the item is running or completed, it is then handed to its queue as usual.
+  */
+
+bool xWorkCancel(XWork_ItemTypeDef *item)
+{
+    XWork_ItemTypeDef **link;
+    XWork_ItemTypeDef * prev = NULL;
+
+    if ( item == NULL || gXWrk.init != 2 )
+        return false;
+
+    EnterCriticalSection(&gXWrk.lock);
+
+    for ( link = &gXWrk.head; *link; prev = *link, link = &(*link)->next )
+    {
+        if ( *link != item )
+            continue;
+
+        *link = item->next;
+        if ( gXWrk.tail == item )
+            gXWrk.tail = prev;
+
+        gXWrk.pending--;
+        InterlockedDecrement(&item->done->inflight);
+        LeaveCriticalSection(&gXWrk.lock);
+        return true;
+    }
+
+    LeaveCriticalSection(&gXWrk.lock);
+    return false;
+}
+
+/**
+  * @brief Claims the next chunk of a range. Chunks shrink as the range drains, large ones
+  *        keep the claims cheap and small ones balance the load of the last participants.
+  * @retval false when the whole range was claimed.
+  */
+
+static bool xWorkClaim(XWork_RangeTypeDef *range, uint32_t *from, uint32_t *to)
+{
+    uint32_t next, chunk;
+
+    do
+    {
+        next = (uint32_t) range->next;
+        if ( next >= range->end )
+            return false;
+
+        chunk = (range->end - next) / (2 * range->participants);
+        if ( chunk < range->grain )
+            chunk = range->grain;
+
+        if ( chunk > range->end - next )
+            chunk = range->end - next;
+
+    } while ( InterlockedCompareExchange(&range->next, (LONG) (next + chunk), (LONG) next) != (LONG) next );
+
+    *from = next;
+    *to   = next + chunk;
+    return true;
+}
+
+/**
+  * @brief Worker thread side of xParallelFor(), processes chunks until the range is drained.
+  * @retval None.
+  */
+
+static void *xWorkRangeHelper(void *arg)
+{
+    XWork_RangeTypeDef *range = (XWork_RangeTypeDef *) arg;
+    uint32_t            from, to;
+
+    while ( xWorkClaim(range, &from, &to) == true )
+        range->fn(from, to, range->ctx);
+
+    return NULL;
+}
+
+/**
+  * @brief Waits until the helpers of xParallelFor() are done with their last chunk, run on a
+  *        worker thread while the calling task is parked, see xTaskRunBlocking().
+  * @retval None.
+  */
+
+static void *xWorkRangeJoin(void *arg)
+{
+    XWork_QueueTypeDef *done = (XWork_QueueTypeDef *) arg;
+
+    EnterCriticalSection(&gXWrk.lock);
+
+    while ( done->inflight > 0 )
+        SleepConditionVariableCS(&gXWrk.drained, &gXWrk.lock, INFINITE);
+
+    LeaveCriticalSection(&gXWrk.lock);
+    return NULL;
+}
+
+/**
+  * @brief Processes the range [begin, end) in chunks shared between the caller and the worker
+  *        threads, returns once the whole range was processed. The caller keeps claiming chunks
+  *        as well, so a range is processed even when no worker thread is available, and a range
+  *        of a single grain is processed in place.
+  *        'fn' runs on other threads and must not use the scheduler API, while the caller is
+  *        busy with its own chunks the other tasks of its scheduler do not run. Once none is
+  *        left, a stackful task is parked until the worker threads are done with theirs.
+  * @param grain: minimum count of indexes per call, 0 to derive it from the range size.
+  * @param fn: call processing the sub range [from, to).
+  * @retval None.
+  */
+
+void xParallelFor(uint32_t begin, uint32_t end, uint32_t grain, RangeFunction_t fn, void *ctx)
+{
+    XWork_ItemTypeDef  items[HAL_XWORK_MAX_THREADS];
+    XWork_QueueTypeDef done = {.head = NULL, .inflight = 0};
+    XWork_RangeTypeDef range;
+    uint32_t           chunks, helpers, i;
+    uint32_t           from, to;
+
+    if ( fn == NULL || begin >= end )
+        return;
+
+    if ( grain == 0 )
+        grain = (end - begin) / ((HAL_XWORK_MAX_THREADS + 1) * HAL_XWORK_CHUNKS_PER_THREAD);
+
+    if ( grain == 0 )
+        grain = 1;
+
+    /* Not worth splitting */
+    chunks = (end - begin) / grain;
+    if ( chunks < 2 )
+    {
+        fn(begin, end, ctx);
+        return;
+    }
+
+    helpers = (chunks - 1 < HAL_XWORK_MAX_THREADS) ? chunks - 1 : HAL_XWORK_MAX_THREADS;
+
+    range.fn           = fn;
+    range.ctx          = ctx;
+    range.next         = (LONG) begin;
+    range.end          = end;
+    range.grain        = grain;
+    range.participants = helpers + 1;
+
+    for ( i = 0; i < helpers; i++ )
+    {
+        memset(&items[i], 0, sizeof(XWork_ItemTypeDef));
+        items[i].fn  = xWorkRangeHelper;
+        items[i].arg = &range;
+
+        if ( xWorkSubmit(&items[i], &done) == false )
+            break;
+    }
+
+    helpers = i;
+
+    while ( xWorkClaim(&range, &from, &to) == true )
+        fn(from, to, ctx);
+
+    /* The helpers not started yet have nothing left to do */
+    for ( i = 0; i < helpers; i++ )
+        xWorkCancel(&items[i]);
+
+    /* The others are busy with their last chunk, the worker finishing the last one releases the join */
+    if ( done.inflight > 0 )
+        xTaskRunBlocking(xWorkRangeJoin, &done);
+
+    /* The workers let go of the items */
+    xWorkCollect(&done);
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/
@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file    logdecode.c
+  * @brief   Binary log file decoder.
+  *          Turns a file written by the logger, see xLogSetBinaryFile(), back into
+  *          text, one line per record in the printf_c() style.
+  *
+  *          Usage: logdecode [-n] <file>
+  *            -n: no colors
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 SolarEdge.
+  * All rights reserved.</center></h2>
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include "ansi.h"
+#include "logformat.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define LOGDECODE_MAX_FORMATS (0x10000) /* Format ids are 16 bits */
+
+/* Escape sequences of the HAL_TermColor values */
+static const char *const gColors[] = {ANSI_MODE, ANSI_RED, ANSI_GREEN, ANSI_BLUE, ANSI_YELLOW};
+
+/* Format definitions read so far, by id */
+static char *   gFormats[LOGDECODE_MAX_FORMATS];
+static uint16_t gFormatColors[LOGDECODE_MAX_FORMATS];
+
+/**
+  * @brief Prints a record.
+  * @retval None.
+  */
+
+static void vPrintRecord(const XLog_FileHeaderTypeDef *hdr, const XLog_RecordHeaderTypeDef *rec, bool colors)
+{
+    uint64_t       start  = ((uint64_t) hdr->cycles_hi << 32) | hdr->cycles_lo;
+    uint64_t       freq   = ((uint64_t) hdr->freq_hi << 32) | hdr->freq_lo;
+    uint64_t       cycles = ((uint64_t) rec->cycles_hi << 32) | rec->cycles_lo;
+    const uint8_t *args   = (const uint8_t *) (rec + 1);
+    uint16_t       color  = gFormatColors[rec->id];
+    uint32_t       ms;
+    char           text[1024];
+
+    if ( gFormats[rec->id] == NULL )
+    {
+        printf("<record of undefined format %u>\n", rec->id);
+        return;
+    }
+
+    ms = hdr->tick + (uint32_t) (freq ? (cycles - start) * 1000 / freq : 0);
+    xLogFormatArgs(text, sizeof(text), gFormats[rec->id], args, rec->size - sizeof(XLog_RecordHeaderTypeDef));
+
+    printf("[%02u.%02u:%02u:%02u.%03u] ", ms / 86400000, (ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000);
+
+    if ( colors )
+        printf("%s%s" ANSI_MODE "\n", gColors[color < sizeof(gColors) / sizeof(gColors[0]) ? color : 0], text);
+    else
+        printf("%s\n", text);
+}
+
+/**
+  * @brief Decodes a binary log file.
+  * @retval exit code.
+  */
+
+int main(int argc, char *argv[])
+{
+    XLog_FileHeaderTypeDef    hdr;
+    XLog_FormatHeaderTypeDef *def;
+    uint16_t                  head[2]; /* Entry id and size */
+    static uint8_t            entry[0x10000];
+    const char *              path   = NULL;
+    bool                      colors = true;
+    uint32_t                  count  = 0;
+    FILE *                    file;
+    int                       i;
+
+    for ( i = 1; i < argc; i++ )
+    {
+        if ( strcmp(argv[i], "-n") == 0 )
+            colors = false;
+        else
+            path = argv[i];
+    }
+
+    if ( path == NULL )
+    {
+        fprintf(stderr, "Usage: logdecode [-n] <file>\n");
+        return 1;
+    }
+
+    file = fopen(path, "rb");
+    if ( file == NULL )
+    {
+        fprintf(stderr, "Cannot open '%s'\n", path);
+        return 1;
+    }
+
+    if ( fread(&hdr, sizeof(hdr), 1, file) != 1 || hdr.magic != XLOG_FILE_MAGIC || hdr.version != XLOG_FILE_VERSION )
+    {
+        fprintf(stderr, "'%s' is not a binary log file\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    while ( fread(head, sizeof(head), 1, file) == 1 )
+    {
+        if ( head[1] < (head[0] == XLOG_ID_FORMAT ? sizeof(XLog_FormatHeaderTypeDef) : sizeof(XLog_RecordHeaderTypeDef)) || head[1] % 4 )
+        {
+            fprintf(stderr, "Corrupted entry after %u records\n", count);
+            break;
+        }
+
+        if ( fread(entry + sizeof(head), head[1] - sizeof(head), 1, file) != 1 )
+        {
+            fprintf(stderr, "Truncated entry after %u records\n", count);
+            break;
+        }
+
+        memcpy(entry, head, sizeof(head));
+
+        if ( head[0] == XLOG_ID_FORMAT )
+        {
+            def = (XLog_FormatHeaderTypeDef *) entry;
+            entry[def->size - 1] = 0;
+
+            free(gFormats[def->format_id]);
+            gFormats[def->format_id] = malloc(def->size - sizeof(XLog_FormatHeaderTypeDef));
+            if ( gFormats[def->format_id] )
+                memcpy(gFormats[def->format_id], def + 1, def->size - sizeof(XLog_FormatHeaderTypeDef));
+
+            gFormatColors[def->format_id] = def->color;
+            continue;
+        }
+
+        vPrintRecord(&hdr, (const XLog_RecordHeaderTypeDef *) entry, colors);
+        count++;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/************************ (C) COPYRIGHT SolarEdge *****END OF FILE****/